@@ -0,0 +1,63 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "lancedb.h"
+#include "bench_util.hpp"
+
+// Measures the ingest rate of lancedb_insert for an id column plus a float vector column,
+// inserted in batches into an existing table. Arrow array construction from the caller
+// buffers is on this path, so run it against both builds to compare a change to it.
+//
+// usage: bench_ingest [num_batches] [batch_size] [dimension]
+
+int main(int argc, char* argv[]) {
+  int num_batches = argc > 1 ? atoi(argv[1]) : 20;
+  int batch_size = argc > 2 ? atoi(argv[2]) : 10000;
+  int dim = argc > 3 ? atoi(argv[3]) : 768;
+
+  system("rm -rf bench_ingest.db");
+  lancedb_handle_t handle = lancedb_init("bench_ingest.db");
+  if (handle == nullptr) {
+    fprintf(stderr, "failed to connect\n");
+    return 1;
+  }
+
+  srand(12345);
+  std::vector<float> vectors((size_t)batch_size * dim);
+  for (auto& v: vectors) {
+    v = (float)rand() / RAND_MAX;
+  }
+  std::vector<int32_t> ids(batch_size);
+
+  if (!lancedb_create_table(handle, "bench_table", vectors.data(), dim, 1)) {
+    fprintf(stderr, "failed to create table\n");
+    return 1;
+  }
+
+  double total_ms = 0;
+  for (int b = 0; b < num_batches; b++) {
+    for (int i = 0; i < batch_size; i++) {
+      ids[i] = b * batch_size + i;
+    }
+    lancedb_field_data_t fields[2] = {
+        { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, (size_t)batch_size, 1, ids.data(), nullptr, nullptr },
+        { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, (size_t)batch_size, (size_t)dim,
+          vectors.data(), nullptr, nullptr },
+    };
+    lancedb_data_t data = { fields, 2 };
+    double t0 = NowMS();
+    if (!lancedb_insert(handle, "bench_table", &data)) {
+      fprintf(stderr, "insert failed\n");
+      return 1;
+    }
+    total_ms += NowMS() - t0;
+  }
+  lancedb_close(handle);
+
+  double rows = (double)num_batches * batch_size;
+  printf("batches=%d  batch_size=%d  dim=%d\n", num_batches, batch_size, dim);
+  printf("insert   total=%10.1f ms   %12.0f rows/s   %8.1f MB/s\n", total_ms, rows / total_ms * 1000,
+         rows * dim * sizeof(float) / total_ms / 1000);
+  return 0;
+}
@@ -0,0 +1,81 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "lancedb.h"
+#include "bench_util.hpp"
+
+// Compares the throughput of a batch of queries run by a loop of lancedb_search calls, each
+// of which opens the table, and by one lancedb_search_batch call, which opens the table once
+// and runs the queries in parallel on the runtime threads.
+//
+// usage: bench_search_batch [num_rows] [dimension] [batch_size] [num_batches]
+
+int main(int argc, char* argv[]) {
+  int num_rows = argc > 1 ? atoi(argv[1]) : 20000;
+  int dim = argc > 2 ? atoi(argv[2]) : 128;
+  int batch_size = argc > 3 ? atoi(argv[3]) : 256;
+  int num_batches = argc > 4 ? atoi(argv[4]) : 10;
+
+  system("rm -rf bench_search_batch.db");
+  lancedb_handle_t handle = lancedb_init("bench_search_batch.db");
+  if (handle == nullptr) {
+    fprintf(stderr, "failed to connect\n");
+    return 1;
+  }
+
+  srand(12345);
+  std::vector<float> data((size_t)num_rows * dim);
+  for (auto& v: data) {
+    v = (float)rand() / RAND_MAX;
+  }
+  if (!lancedb_create_table(handle, "bench_table", data.data(), dim, num_rows)) {
+    fprintf(stderr, "failed to create table\n");
+    return 1;
+  }
+
+  std::vector<float> queries((size_t)batch_size * dim);
+  for (auto& v: queries) {
+    v = (float)rand() / RAND_MAX;
+  }
+  std::vector<lancedb_data_t> results(batch_size);
+
+  double loop_ms = 0;
+  for (int b = 0; b < num_batches; b++) {
+    double t0 = NowMS();
+    for (int i = 0; i < batch_size; i++) {
+      if (!lancedb_search(handle, "bench_table", "vector", queries.data() + (size_t)i * dim, dim, &results[i])) {
+        fprintf(stderr, "search failed\n");
+        return 1;
+      }
+    }
+    loop_ms += NowMS() - t0;
+    for (auto& result: results) {
+      lancedb_free_search_results(&result);
+    }
+  }
+
+  double batch_ms = 0;
+  for (int b = 0; b < num_batches; b++) {
+    double t0 = NowMS();
+    bool ok = lancedb_search_batch(handle, "bench_table", "vector", queries.data(), batch_size, dim,
+                                   nullptr, results.data());
+    batch_ms += NowMS() - t0;
+    for (auto& result: results) {
+      lancedb_free_search_results(&result);
+    }
+    if (!ok) {
+      fprintf(stderr, "batch search failed\n");
+      return 1;
+    }
+  }
+  lancedb_close(handle);
+
+  double total_queries = (double)batch_size * num_batches;
+  printf("rows=%d  dim=%d  batch_size=%d  batches=%d\n", num_rows, dim, batch_size, num_batches);
+  printf("%-16s %10.3f ms/batch   %10.0f queries/s\n", "single loop", loop_ms / num_batches,
+         total_queries / loop_ms * 1000);
+  printf("%-16s %10.3f ms/batch   %10.0f queries/s   (x%.2f)\n", "batch", batch_ms / num_batches,
+         total_queries / batch_ms * 1000, loop_ms / batch_ms);
+  return 0;
+}
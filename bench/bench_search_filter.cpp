@@ -0,0 +1,107 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "lancedb.h"
+#include "bench_util.hpp"
+
+// Compares filtered searches with the filter applied before the nearest rows are searched
+// (prefilter) and after (postfilter), for a selective filter (one tenant out of many) and a
+// broad one (most tenants). With a selective filter, postfilter drops nearly all of the k
+// nearest rows, so the rows returned per query are reported along with the latency.
+//
+// usage: bench_search_filter [num_rows] [dimension] [num_queries] [num_tenants]
+
+int main(int argc, char* argv[]) {
+  int num_rows = argc > 1 ? atoi(argv[1]) : 100000;
+  int dim = argc > 2 ? atoi(argv[2]) : 128;
+  int num_queries = argc > 3 ? atoi(argv[3]) : 200;
+  int num_tenants = argc > 4 ? atoi(argv[4]) : 1000;
+  const size_t k = 10;
+
+  system("rm -rf bench_search_filter.db");
+  lancedb_handle_t handle = lancedb_init("bench_search_filter.db");
+  if (handle == nullptr) {
+    fprintf(stderr, "failed to connect\n");
+    return 1;
+  }
+
+  srand(12345);
+  std::vector<float> vectors((size_t)num_rows * dim);
+  for (auto& v: vectors) {
+    v = (float)rand() / RAND_MAX;
+  }
+  std::vector<int32_t> ids(num_rows);
+  std::vector<int32_t> tenants(num_rows);
+  for (int i = 0; i < num_rows; i++) {
+    ids[i] = i;
+    tenants[i] = i % num_tenants;
+  }
+
+  lancedb_table_field_t schema_fields[3] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 0, 1, 0 },
+      { "tenant_id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 0, 1, 0 },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 0, dim, 0 },
+  };
+  lancedb_schema_t schema = { schema_fields, 3 };
+  lancedb_field_data_t fields[3] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, (size_t)num_rows, 1, ids.data(), nullptr, nullptr },
+      { "tenant_id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, (size_t)num_rows, 1, tenants.data(), nullptr, nullptr },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, (size_t)num_rows, (size_t)dim,
+        vectors.data(), nullptr, nullptr },
+  };
+  lancedb_data_t data = { fields, 3 };
+  if (!lancedb_create_table_with_data(handle, "bench_table", &schema, &data, nullptr)) {
+    fprintf(stderr, "failed to create table\n");
+    return 1;
+  }
+
+  char selective[64];
+  char broad[64];
+  snprintf(selective, sizeof(selective), "tenant_id = %d", num_tenants / 2);
+  snprintf(broad, sizeof(broad), "tenant_id < %d", num_tenants * 9 / 10);
+  struct Case {
+    const char* name;
+    const char* filter;
+    int postfilter;
+  };
+  const Case cases[] = {
+    { "none", nullptr, 0 },
+    { "selective pre", selective, 0 },
+    { "selective post", selective, 1 },
+    { "broad pre", broad, 0 },
+    { "broad post", broad, 1 },
+  };
+
+  printf("rows=%d  dim=%d  tenants=%d  k=%zd\n", num_rows, dim, num_tenants, k);
+  for (const Case& c: cases) {
+    lancedb_search_options_t options;
+    memset(&options, 0, sizeof(options));
+    options.limit = k;
+    options.filter = c.filter;
+    options.postfilter = c.postfilter;
+
+    std::vector<double> search_ms;
+    size_t total_rows = 0;
+    for (int i = 0; i < num_queries; i++) {
+      const float* query = vectors.data() + (size_t)(i * 7919 % num_rows) * dim;
+      lancedb_data_t results;
+      double t0 = NowMS();
+      bool ok = lancedb_search_with_options(handle, "bench_table", "vector", (void*)query, dim,
+                                            &options, &results);
+      search_ms.push_back(NowMS() - t0);
+      if (!ok) {
+        fprintf(stderr, "search failed\n");
+        return 1;
+      }
+      if (results.num_fields > 0) {
+        total_rows += results.fields[0].data_count;
+      }
+      lancedb_free_search_results(&results);
+    }
+    PrintStats(c.name, search_ms, (double)total_rows / num_queries);
+  }
+  lancedb_close(handle);
+  return 0;
+}
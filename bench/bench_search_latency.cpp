@@ -0,0 +1,66 @@
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "lancedb.h"
+#include "bench_util.hpp"
+
+// Measures the per-call latency of lancedb_search for a small k against a small table,
+// where the fixed per-call cost (runtime setup, table open) dominates the actual search.
+//
+// usage: bench_search_latency [num_rows] [dimension] [num_queries]
+
+int main(int argc, char* argv[]) {
+  int num_rows = argc > 1 ? atoi(argv[1]) : 1000;
+  int dim = argc > 2 ? atoi(argv[2]) : 128;
+  int num_queries = argc > 3 ? atoi(argv[3]) : 1000;
+
+  system("rm -rf bench_search_latency.db");
+
+  std::vector<double> connect_ms;
+  for (int i = 0; i < 10; i++) {
+    double t0 = NowMS();
+    lancedb_handle_t hnd = lancedb_init("bench_search_latency.db");
+    connect_ms.push_back(NowMS() - t0);
+    lancedb_close(hnd);
+  }
+
+  lancedb_handle_t handle = lancedb_init("bench_search_latency.db");
+  if (handle == nullptr) {
+    fprintf(stderr, "failed to connect\n");
+    return 1;
+  }
+
+  srand(12345);
+  std::vector<float> data((size_t)num_rows * dim);
+  for (auto& v: data) {
+    v = (float)rand() / RAND_MAX;
+  }
+  for (int i = 0; i < num_rows; i++) {
+    Normalize(data.data() + (size_t)i * dim, dim);
+  }
+  if (!lancedb_create_table(handle, "bench_table", data.data(), dim, num_rows)) {
+    fprintf(stderr, "failed to create table\n");
+    return 1;
+  }
+
+  std::vector<double> search_ms;
+  for (int i = 0; i < num_queries; i++) {
+    const float* query = data.data() + (size_t)(i % num_rows) * dim;
+    lancedb_data_t results;
+    double t0 = NowMS();
+    bool ok = lancedb_search(handle, "bench_table", "vector", (void*)query, dim, &results);
+    search_ms.push_back(NowMS() - t0);
+    if (!ok) {
+      fprintf(stderr, "search failed\n");
+      return 1;
+    }
+    lancedb_free_search_results(&results);
+  }
+  lancedb_close(handle);
+
+  printf("rows=%d  dim=%d\n", num_rows, dim);
+  PrintStats("connect", connect_ms);
+  PrintStats("search", search_ms);
+  return 0;
+}
@@ -0,0 +1,89 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "lancedb.h"
+#include "bench_util.hpp"
+
+// Compares the per-query cost of lancedb_search with each distance metric over the same
+// normalized vectors, for which all of them give the same order. Without an index every row
+// is compared with the query, so the cost of the metric itself shows the most. With `index`,
+// an IVF_PQ index is built with the metric before its queries are run.
+//
+// usage: bench_search_metric [num_rows] [dimension] [num_queries] [index]
+
+int main(int argc, char* argv[]) {
+  int num_rows = argc > 1 ? atoi(argv[1]) : 50000;
+  int dim = argc > 2 ? atoi(argv[2]) : 768;
+  int num_queries = argc > 3 ? atoi(argv[3]) : 200;
+  bool with_index = argc > 4 && strcmp(argv[4], "index") == 0;
+
+  system("rm -rf bench_search_metric.db");
+
+  lancedb_handle_t handle = lancedb_init("bench_search_metric.db");
+  if (handle == nullptr) {
+    fprintf(stderr, "failed to connect\n");
+    return 1;
+  }
+
+  srand(12345);
+  std::vector<float> data((size_t)num_rows * dim);
+  for (auto& v: data) {
+    v = (float)rand() / RAND_MAX - 0.5f;
+  }
+  for (int i = 0; i < num_rows; i++) {
+    Normalize(data.data() + (size_t)i * dim, dim);
+  }
+  if (!lancedb_create_table(handle, "bench_table", data.data(), dim, num_rows)) {
+    fprintf(stderr, "failed to create table\n");
+    return 1;
+  }
+
+  struct Metric {
+    const char* name;
+    lancedb_distance_type_t type;
+  };
+  const Metric metrics[] = {
+    { "cosine", kLanceDBDistanceCosine },
+    { "l2", kLanceDBDistanceL2 },
+    { "dot", kLanceDBDistanceDot },
+  };
+
+  printf("rows=%d  dim=%d  %s\n", num_rows, dim, with_index ? "ivf_pq index" : "no index");
+  for (const Metric& metric: metrics) {
+    if (with_index) {
+      lancedb_index_options_t index_options;
+      memset(&index_options, 0, sizeof(index_options));
+      index_options.distance_type = metric.type;
+      double t0 = NowMS();
+      if (!lancedb_create_index(handle, "bench_table", "vector", &index_options)) {
+        fprintf(stderr, "failed to create index\n");
+        return 1;
+      }
+      printf("%-16s index built in %.1f ms\n", metric.name, NowMS() - t0);
+    }
+
+    lancedb_search_options_t options;
+    memset(&options, 0, sizeof(options));
+    options.distance_type = metric.type;
+
+    std::vector<double> search_ms;
+    for (int i = 0; i < num_queries; i++) {
+      const float* query = data.data() + (size_t)(i * 7919 % num_rows) * dim;
+      lancedb_data_t results;
+      double t0 = NowMS();
+      bool ok = lancedb_search_with_options(handle, "bench_table", "vector", (void*)query, dim,
+                                            &options, &results);
+      search_ms.push_back(NowMS() - t0);
+      if (!ok) {
+        fprintf(stderr, "search failed\n");
+        return 1;
+      }
+      lancedb_free_search_results(&results);
+    }
+    PrintStats(metric.name, search_ms);
+  }
+  lancedb_close(handle);
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "lancedb.h"
+#include "bench_util.hpp"
+
+// Measures search throughput (queries per second) with an increasing number of threads
+// sharing one connection and one opened table, and reports the speedup over one thread.
+//
+// usage: bench_search_throughput [max_threads] [queries_per_thread] [num_rows] [dimension]
+
+int main(int argc, char* argv[]) {
+  int max_threads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+  int queries_per_thread = argc > 2 ? atoi(argv[2]) : 200;
+  int num_rows = argc > 3 ? atoi(argv[3]) : 10000;
+  int dim = argc > 4 ? atoi(argv[4]) : 128;
+
+  system("rm -rf bench_search_throughput.db");
+  lancedb_handle_t handle = lancedb_init("bench_search_throughput.db");
+  if (handle == nullptr) {
+    fprintf(stderr, "failed to connect\n");
+    return 1;
+  }
+
+  srand(12345);
+  std::vector<float> data((size_t)num_rows * dim);
+  for (auto& v: data) {
+    v = (float)rand() / RAND_MAX;
+  }
+  if (!lancedb_create_table(handle, "bench_table", data.data(), dim, num_rows)) {
+    fprintf(stderr, "failed to create table\n");
+    return 1;
+  }
+  lancedb_table_handle_t table = lancedb_open_table(handle, "bench_table");
+
+  printf("rows=%d  dim=%d  queries/thread=%d\n", num_rows, dim, queries_per_thread);
+  double base_qps = 0;
+  for (int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    std::vector<std::thread> threads;
+    std::vector<int> failures(num_threads, 0);
+    double t0 = NowMS();
+    for (int t = 0; t < num_threads; t++) {
+      threads.emplace_back([&, t]() {
+        for (int i = 0; i < queries_per_thread; i++) {
+          const float* query = data.data() + (size_t)((t * queries_per_thread + i) % num_rows) * dim;
+          lancedb_data_t results;
+          if (!lancedb_table_search(table, "vector", (void*)query, dim, &results)) {
+            failures[t]++;
+            continue;
+          }
+          lancedb_free_search_results(&results);
+        }
+      });
+    }
+    for (auto& th: threads) {
+      th.join();
+    }
+    double elapsed = NowMS() - t0;
+    double qps = num_threads * queries_per_thread / (elapsed / 1000.0);
+    if (num_threads == 1) {
+      base_qps = qps;
+    }
+    int total_failures = 0;
+    for (int f: failures) {
+      total_failures += f;
+    }
+    printf("threads=%-3d  qps=%10.1f  speedup=%5.2fx  failures=%d\n",
+           num_threads, qps, qps / base_qps, total_failures);
+  }
+
+  lancedb_table_close(table);
+  lancedb_close(handle);
+  return 0;
+}
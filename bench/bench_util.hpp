@@ -0,0 +1,52 @@
+#ifndef LANCEDB_BENCH_BENCH_UTIL_HPP_
+#define LANCEDB_BENCH_BENCH_UTIL_HPP_
+
+#include <cstdio>
+#include <cmath>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+// Helpers shared by the benchmarks.
+
+static inline double NowMS() {
+  using namespace std::chrono;
+  return duration_cast<duration<double, std::milli>>(steady_clock::now().time_since_epoch()).count();
+}
+
+static inline void Normalize(float* vec, size_t n) {
+  float norm = 0;
+  for (size_t i = 0; i < n; i++) {
+    norm += vec[i] * vec[i];
+  }
+  norm = std::sqrt(norm);
+  if (norm != 0) {
+    for (size_t i = 0; i < n; i++) {
+      vec[i] /= norm;
+    }
+  }
+}
+
+// Sorts `samples` and prints their count, average, p50 and p99 in ms, without a newline.
+static inline void PrintLatency(const char* tag, std::vector<double>& samples) {
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (double s: samples) {
+    sum += s;
+  }
+  printf("%-20s n=%-6zd avg=%8.3f ms   p50=%8.3f ms   p99=%8.3f ms", tag, samples.size(),
+         sum / samples.size(), samples[samples.size() / 2], samples[samples.size() * 99 / 100]);
+}
+
+static inline void PrintStats(const char* tag, std::vector<double>& samples) {
+  PrintLatency(tag, samples);
+  printf("\n");
+}
+
+// Also prints the average number of rows returned per query.
+static inline void PrintStats(const char* tag, std::vector<double>& samples, double avg_rows) {
+  PrintLatency(tag, samples);
+  printf("   rows=%6.1f\n", avg_rows);
+}
+
+#endif //LANCEDB_BENCH_BENCH_UTIL_HPP_
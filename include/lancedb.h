@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
 typedef enum {
   kLanceDBFieldTypeInt8,
@@ -48,6 +49,12 @@ typedef struct lancedb_field_data_t {
   size_t dimension; // only for vector
   void* data;       // for vector, it is a pointer to a 2D array; for scalar, it is a pointer to a 1D array
   size_t* binary_size; // only for blob type
+  // Only for string and blob types. When set, `data` is one contiguous buffer of all the values
+  // and row i is the bytes [offsets[i], offsets[i + 1]) of it (strings are not NUL-terminated);
+  // there are data_count + 1 offsets. Otherwise `data` is an array of per-row pointers (strings
+  // NUL-terminated, blob sizes in binary_size), and `offsets` must be NULL: zero-initialize
+  // the struct (e.g. `= {0}`) or set it. Search results always use the contiguous layout.
+  size_t* offsets;
 } lancedb_field_data_t;
 
 typedef struct lancedb_data_t {
@@ -55,14 +62,243 @@ typedef struct lancedb_data_t {
   size_t num_fields;
 } lancedb_data_t;
 
+// Connection options, fields left 0 (or NULL) use the default.
+typedef struct lancedb_options_t {
+  size_t worker_threads;       // runtime worker threads, default is the number of CPU cores
+  size_t max_blocking_threads; // threads for blocking file IO, default is 512
+  const int* cpu_affinity;     // CPUs the runtime threads are pinned to (Linux and Android only)
+  size_t num_cpu_affinity;
+  size_t index_cache_size;     // index entries cached for each opened table
+  size_t metadata_cache_size;  // metadata entries cached for each opened table
+} lancedb_options_t;
+
+// Commit thresholds of an appender, fields left 0 use the default. The buffered rows are
+// committed once one of them is reached. Rows buffered for max_interval_ms are committed by a
+// timer on the connection runtime, even if nothing more is appended.
+typedef struct lancedb_appender_options_t {
+  size_t max_rows;          // default is 100000 rows
+  size_t max_bytes;         // default is 64 MB
+  uint64_t max_interval_ms; // default is no time limit
+} lancedb_appender_options_t;
+
+typedef enum lancedb_write_mode_t {
+  kLanceDBWriteModeAppend,    // add the rows to the table (create a new table)
+  kLanceDBWriteModeOverwrite, // replace the table data (replace an existing table)
+} lancedb_write_mode_t;
+
+// Lance write parameters, fields left 0 use the lance default. Larger files and row groups
+// mean fewer, bigger reads for scans and searches, smaller ones less memory while writing.
+typedef struct lancedb_write_options_t {
+  size_t max_rows_per_file;
+  size_t max_rows_per_group;
+  size_t max_bytes_per_file;
+  lancedb_write_mode_t mode;
+} lancedb_write_options_t;
+
+// Distance between vectors. Dot is cheapest but ranks by similarity only for normalized
+// vectors, for which it orders the rows as Cosine does.
+typedef enum lancedb_distance_type_t {
+  kLanceDBDistanceCosine, // 1 - cosine similarity
+  kLanceDBDistanceL2,     // squared euclidean distance
+  kLanceDBDistanceDot,    // 1 - dot product
+} lancedb_distance_type_t;
+
+// Per query search parameters, fields left 0 use the default.
+typedef struct lancedb_search_options_t {
+  size_t limit;           // number of nearest rows returned, default is 10
+  size_t nprobes;         // IVF partitions searched with an index, default is 20. More partitions
+                          // find more of the true neighbors, at the cost of latency
+  uint32_t refine_factor; // with a PQ index, fetch limit * refine_factor candidates and re-rank
+                          // them on the full vectors. Default is no re-ranking
+  lancedb_distance_type_t distance_type; // default is kLanceDBDistanceCosine. An indexed column
+                                         // should be searched with the metric of its index
+  // Columns returned, NULL for all of them. _distance is always returned. Leaving out the
+  // vector column saves reading and copying it for every row found.
+  const char* const* select_columns;
+  size_t num_select_columns;
+  // SQL predicate the rows found have to match, e.g. "tenant_id = 42 AND time >= 1700000000",
+  // NULL for none. By default it is applied before the nearest rows are searched (prefilter),
+  // so `limit` rows are returned whenever that many rows match. With postfilter, the nearest
+  // rows are searched first and the ones not matching are dropped, which can return fewer rows.
+  const char* filter;
+  int postfilter;
+} lancedb_search_options_t;
+
+// IVF_PQ vector index parameters, fields left 0 use the default.
+typedef struct lancedb_index_options_t {
+  lancedb_distance_type_t distance_type; // default is kLanceDBDistanceCosine
+  uint32_t num_partitions;               // default is sqrt(number of rows)
+  uint32_t num_sub_vectors;              // default is dimension / 16
+} lancedb_index_options_t;
+
+// prune_older_than_secs of the default age, 7 days.
+#define LANCEDB_PRUNE_DEFAULT_AGE UINT64_MAX
+
+// Steps of lancedb_optimize, run in this order. Fields left 0 use the default, except
+// prune_older_than_secs: 0 removes every version but the latest, LANCEDB_PRUNE_DEFAULT_AGE
+// keeps the versions of the last 7 days.
+typedef struct lancedb_optimize_options_t {
+  int compact;                     // rewrite small fragments into larger ones
+  size_t target_rows_per_fragment; // default is 1048576 rows
+  int prune;                       // remove the versions older than prune_older_than_secs
+  uint64_t prune_older_than_secs;  // LANCEDB_PRUNE_DEFAULT_AGE for the default
+  int optimize_indices;            // add the rows written since an index was built to it
+} lancedb_optimize_options_t;
+
+typedef struct lancedb_optimize_stats_t {
+  uint64_t fragments_removed;
+  uint64_t fragments_added;
+  uint64_t files_removed;
+  uint64_t files_added;
+  uint64_t versions_removed;
+  uint64_t bytes_removed;     // size of the files of the removed versions
+  uint64_t elapsed_ms;
+} lancedb_optimize_stats_t;
+
+// What lancedb_upsert does with the rows, matched with the table rows on the key column.
+typedef enum lancedb_upsert_mode_t {
+  kLanceDBUpsertUpdateOrInsert, // replace the matched rows, insert the others
+  kLanceDBUpsertUpdateOnly,     // replace the matched rows, drop the others
+  kLanceDBUpsertInsertOnly,     // insert the rows that match none, drop the others
+} lancedb_upsert_mode_t;
+
+// When a write to a write buffer returns.
+typedef enum lancedb_durability_t {
+  kLanceDBDurabilityEnqueued,  // once the rows are queued, commit failures are reported by a flush
+  kLanceDBDurabilityCommitted, // once the commit holding the rows is done
+} lancedb_durability_t;
+
+// Options of a write buffer, fields left 0 use the default.
+typedef struct lancedb_write_buffer_options_t {
+  uint64_t flush_interval_ms;      // how long rows are gathered before a commit, default is 100 ms
+  size_t max_rows;                 // commit before the interval is over once this many rows are queued,
+                                   // default is 100000
+  lancedb_durability_t durability; // default is kLanceDBDurabilityEnqueued
+} lancedb_write_buffer_options_t;
+
+// Statistics of a write buffer, since it was opened.
+typedef struct lancedb_write_buffer_stats_t {
+  uint64_t num_writes;
+  uint64_t num_commits;
+  uint64_t num_failed_commits;
+  uint64_t num_committed_rows;
+  uint64_t min_commit_rows;   // rows of the smallest commit
+  uint64_t max_commit_rows;   // rows of the largest commit
+  uint64_t last_commit_rows;
+  uint64_t pending_rows;      // rows queued or being committed
+} lancedb_write_buffer_stats_t;
+
+// File formats of lancedb_import_vectors, all holding little-endian float32 vectors.
+typedef enum lancedb_vector_format_t {
+  kLanceDBVectorFormatFvecs, // each vector is an int32 dimension followed by the values
+  kLanceDBVectorFormatNpy,   // 2D array in a .npy file, in C order
+  kLanceDBVectorFormatRaw,   // vectors back to back, after an optional header
+} lancedb_vector_format_t;
+
+// Options of lancedb_import_vectors, fields left 0 (or NULL) use the default.
+typedef struct lancedb_import_options_t {
+  const char* vector_column; // default is "vector"
+  const char* id_column;     // column filled with consecutive ids, default is none
+  int64_t first_id;          // id of the first vector in the file. A created id column is
+                             // Int32, the import fails if the ids do not fit the column type
+  size_t dimension;          // required for raw files, checked against the file otherwise
+  size_t header_size;        // bytes to skip at the start of a raw file
+  size_t chunk_rows;         // rows copied and written at a time, default is 8192
+  int create_table;          // create the table (with the id and vector columns) instead of appending
+} lancedb_import_options_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif // __cplusplus
 
+// Arrow C data interface, see https://arrow.apache.org/docs/format/CDataInterface.html
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+#endif // ARROW_C_DATA_INTERFACE
+
+#ifndef ARROW_C_STREAM_INTERFACE
+#define ARROW_C_STREAM_INTERFACE
+
+struct ArrowArrayStream {
+  // Callbacks providing stream functionality
+  int (*get_schema)(struct ArrowArrayStream*, struct ArrowSchema* out);
+  int (*get_next)(struct ArrowArrayStream*, struct ArrowArray* out);
+  const char* (*get_last_error)(struct ArrowArrayStream*);
+
+  // Release callback
+  void (*release)(struct ArrowArrayStream*);
+
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+#endif // ARROW_C_STREAM_INTERFACE
+
+// Completion callbacks of the asynchronous API. They are called exactly once if the call
+// returns true (it returns false for invalid arguments, without calling them), on an internal
+// worker thread, so they must not block or call the blocking functions of this library.
+// `search_results` is only valid during the callback: on success copy the struct out and
+// release it with lancedb_free_search_results when done.
+typedef void (*lancedb_search_callback_t)(void* user_data, bool success,
+                                          lancedb_data_t* search_results);
+typedef void (*lancedb_insert_callback_t)(void* user_data, bool success);
+
+// Producer of the batches of a streaming insert. It fills `batch` and returns 1, or returns
+// 0 at the end of the data and -1 on error (nothing is committed then, nor when it returns 1
+// with no fields). The batch data is copied, it only has to stay valid until the next call.
+// The producer is called from the calling thread or a runtime worker thread, never from two
+// threads at once.
+typedef int (*lancedb_batch_producer_t)(void* user_data, lancedb_data_t* batch);
+
+// Handles can be used from multiple threads at the same time.
 typedef void* lancedb_handle_t;
+typedef void* lancedb_table_handle_t;
+typedef void* lancedb_appender_handle_t;
+typedef void* lancedb_write_buffer_handle_t;
 
 lancedb_handle_t lancedb_init(const char* uri);
 
+// Same as lancedb_init, with options (can be NULL). The options are copied.
+lancedb_handle_t lancedb_init_with_options(const char* uri, const lancedb_options_t* options);
+
 bool lancedb_close(lancedb_handle_t handle);
 
 bool lancedb_create_table(lancedb_handle_t handle, const char* table_name,
@@ -71,14 +307,165 @@ bool lancedb_create_table(lancedb_handle_t handle, const char* table_name,
 bool lancedb_create_table_with_schema(lancedb_handle_t handle, const char* table_name,
                                       lancedb_schema_t* schema);
 
+// Float32 data given for a Float16 column (scalar or vector) is converted to half precision
+// when inserted, here and in the other inserts of field data.
 bool lancedb_insert(lancedb_handle_t handle, const char* table_name,
                     lancedb_data_t* field_data);
 
+// Same as lancedb_create_table_with_schema and lancedb_insert, with write options (can be
+// NULL). The table is created with its first rows (can be NULL) in a single commit.
+bool lancedb_create_table_with_data(lancedb_handle_t handle, const char* table_name,
+                                    lancedb_schema_t* schema, lancedb_data_t* field_data,
+                                    const lancedb_write_options_t* options);
+
+bool lancedb_insert_with_options(lancedb_handle_t handle, const char* table_name,
+                                 lancedb_data_t* field_data, const lancedb_write_options_t* options);
+
+// The query vector `data` has the element type of the column: float, double, or IEEE 754 half
+// precision values for Float16 columns.
 bool lancedb_search(lancedb_handle_t handle, const char* table_name, const char* column_name,
                     void* data, int dimension, lancedb_data_t* search_results);
 
+// Same as lancedb_search, with search options (can be NULL).
+bool lancedb_search_with_options(lancedb_handle_t handle, const char* table_name,
+                                 const char* column_name, void* data, int dimension,
+                                 const lancedb_search_options_t* options,
+                                 lancedb_data_t* search_results);
+
+// Runs `num_queries` searches of the same column at once, in parallel on the runtime threads,
+// with the table opened once for all of them. `queries` holds the query vectors one after the
+// other (num_queries * dimension values) and `search_results` is an array of num_queries results,
+// in the order of the queries. All the results are set even if false is returned (a failed query
+// has no fields), release each of them with lancedb_free_search_results.
+bool lancedb_search_batch(lancedb_handle_t handle, const char* table_name, const char* column_name,
+                          void* queries, size_t num_queries, int dimension,
+                          const lancedb_search_options_t* options, lancedb_data_t* search_results);
+
 bool lancedb_free_search_results(lancedb_data_t* search_results);
 
+// Opened table, which caches the table schema so that inserts and searches on it
+// do not open the table again. It keeps the connection alive until it is closed.
+lancedb_table_handle_t lancedb_open_table(lancedb_handle_t handle, const char* table_name);
+
+bool lancedb_table_close(lancedb_table_handle_t table);
+
+bool lancedb_table_insert(lancedb_table_handle_t table, lancedb_data_t* field_data);
+
+bool lancedb_table_search(lancedb_table_handle_t table, const char* column_name,
+                          void* data, int dimension, lancedb_data_t* search_results);
+
+bool lancedb_table_search_with_options(lancedb_table_handle_t table, const char* column_name,
+                                       void* data, int dimension,
+                                       const lancedb_search_options_t* options,
+                                       lancedb_data_t* search_results);
+
+// Table maintenance: compacts the fragments left by many small writes, removes old versions
+// and brings the indices up to date. With NULL options, all the steps run with the defaults.
+// `stats` can be NULL.
+bool lancedb_optimize(lancedb_handle_t handle, const char* table_name,
+                      const lancedb_optimize_options_t* options, lancedb_optimize_stats_t* stats);
+
+// Builds an IVF_PQ index on a vector column, replacing the index the column has. Training
+// needs at least 256 rows. `options` can be NULL.
+bool lancedb_create_index(lancedb_handle_t handle, const char* table_name, const char* column_name,
+                          const lancedb_index_options_t* options);
+
+// Merges the rows into the table by the values of `key_column`, in a single commit. The rows
+// must have all the columns of the table, and their keys should be unique.
+bool lancedb_upsert(lancedb_handle_t handle, const char* table_name, const char* key_column,
+                    lancedb_data_t* field_data, lancedb_upsert_mode_t mode);
+
+// Inserts a record batch exported through the Arrow C data interface: `array` is a struct
+// array of the columns, described by `schema`. The buffers are used without copying them.
+// The function takes ownership of `array`, which is released (and marked so) on return,
+// on failure as well; `schema` is only borrowed and stays owned by the caller.
+bool lancedb_insert_arrow(lancedb_handle_t handle, const char* table_name,
+                          struct ArrowArray* array, struct ArrowSchema* schema);
+
+// Inserts all the record batches of an Arrow C stream in a single commit. The function
+// takes ownership of `stream` and releases it.
+bool lancedb_insert_arrow_stream(lancedb_handle_t handle, const char* table_name,
+                                 struct ArrowArrayStream* stream);
+
+// Streaming insert and create: the batches are pulled from `producer` while they are written,
+// and committed together as one table version. Memory use is bounded by the batch size, not
+// by the size of the whole data.
+bool lancedb_insert_stream(lancedb_handle_t handle, const char* table_name,
+                           lancedb_batch_producer_t producer, void* user_data);
+
+bool lancedb_create_table_stream(lancedb_handle_t handle, const char* table_name,
+                                 lancedb_schema_t* schema,
+                                 lancedb_batch_producer_t producer, void* user_data);
+
+// Imports all the vectors of a file in a single commit. The file is memory mapped and read
+// one chunk of rows at a time, so memory use does not depend on the size of the file. Columns
+// of the table other than the vector and id columns have to be nullable, and are left null.
+bool lancedb_import_vectors(lancedb_handle_t handle, const char* table_name, const char* path,
+                            lancedb_vector_format_t format, const lancedb_import_options_t* options);
+
+// Appender, which buffers the appended rows and commits them to the table together, instead
+// of making one table version per insert. The rows are copied, and checked against the table
+// schema when appended. Rows still buffered are committed by lancedb_appender_close. A failed
+// commit keeps the rows buffered, to be committed again on the next flush.
+lancedb_appender_handle_t lancedb_appender_open(lancedb_handle_t handle, const char* table_name,
+                                                const lancedb_appender_options_t* options);
+
+bool lancedb_appender_append(lancedb_appender_handle_t appender, lancedb_data_t* field_data);
+
+bool lancedb_appender_flush(lancedb_appender_handle_t appender);
+
+bool lancedb_appender_close(lancedb_appender_handle_t appender);
+
+// Write buffer, to be shared by many writer threads: a write converts the rows, checks them
+// against the table schema and queues them without waiting for other writes. A background
+// flusher commits everything queued during an interval as one table version. Rows of a failed
+// commit are dropped. lancedb_write_buffer_flush commits the queued rows now, and returns
+// false if a commit failed since the previous flush; lancedb_write_buffer_close commits the
+// queued rows and returns false if a commit failed since then. Calls that wait for the flusher
+// (flush, close, and writes with kLanceDBDurabilityCommitted) return false without doing
+// anything when called from a callback of an asynchronous call, which runs on a runtime thread.
+lancedb_write_buffer_handle_t lancedb_write_buffer_open(lancedb_handle_t handle, const char* table_name,
+                                                        const lancedb_write_buffer_options_t* options);
+
+bool lancedb_write_buffer_write(lancedb_write_buffer_handle_t write_buffer, lancedb_data_t* field_data);
+
+bool lancedb_write_buffer_flush(lancedb_write_buffer_handle_t write_buffer);
+
+bool lancedb_write_buffer_get_stats(lancedb_write_buffer_handle_t write_buffer,
+                                    lancedb_write_buffer_stats_t* stats);
+
+bool lancedb_write_buffer_close(lancedb_write_buffer_handle_t write_buffer);
+
+// Asynchronous variants, which return as soon as the request is queued on the runtime of
+// the connection. When they return false, the callback is not called. The query vector
+// `data` has to stay valid until the callback is called; the inserted `field_data` is
+// copied before returning.
+bool lancedb_search_async(lancedb_handle_t handle, const char* table_name, const char* column_name,
+                          void* data, int dimension,
+                          lancedb_search_callback_t callback, void* user_data);
+
+// `options` as in lancedb_search_with_options, copied before returning.
+bool lancedb_search_async_with_options(lancedb_handle_t handle, const char* table_name,
+                                       const char* column_name, void* data, int dimension,
+                                       const lancedb_search_options_t* options,
+                                       lancedb_search_callback_t callback, void* user_data);
+
+bool lancedb_insert_async(lancedb_handle_t handle, const char* table_name,
+                          lancedb_data_t* field_data,
+                          lancedb_insert_callback_t callback, void* user_data);
+
+bool lancedb_table_search_async(lancedb_table_handle_t table, const char* column_name,
+                                void* data, int dimension,
+                                lancedb_search_callback_t callback, void* user_data);
+
+bool lancedb_table_search_async_with_options(lancedb_table_handle_t table, const char* column_name,
+                                             void* data, int dimension,
+                                             const lancedb_search_options_t* options,
+                                             lancedb_search_callback_t callback, void* user_data);
+
+bool lancedb_table_insert_async(lancedb_table_handle_t table, lancedb_data_t* field_data,
+                                lancedb_insert_callback_t callback, void* user_data);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
@@ -5,8 +5,17 @@
 #include <vector>
 #include <type_traits>
 #include <tuple>
+#include <utility>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <sstream>
+#include <limits>
 
 #include "lancedb.h"
+#include "lancedb_coroutine.hpp"
+#include "lancedb_float16.hpp"
 
 namespace lancedb {
 
@@ -59,6 +68,7 @@ class LanceDBTypes {
   typedef uint16_t    UInt16;
   typedef uint32_t    UInt32;
   typedef uint64_t    UInt64;
+  typedef ::lancedb::Float16 Float16;
   typedef float       Float32;
   typedef double      Float64;
   typedef std::string String;
@@ -68,12 +78,34 @@ class LanceDBTypes {
 
 class LanceDB {
 public:
+  // Connection options, see lancedb_options_t. Fields left 0 use the default.
+  struct Options {
+    size_t worker_threads = 0;
+    size_t max_blocking_threads = 0;
+    std::vector<int> cpu_affinity;
+    size_t index_cache_size = 0;
+    size_t metadata_cache_size = 0;
+  };
+
   explicit LanceDB(const char* uri) {
     hnd_ = lancedb_init(uri);
     is_inited_ = hnd_ != nullptr;
   }
 
+  LanceDB(const char* uri, const Options& options) {
+    lancedb_options_t opts;
+    opts.worker_threads = options.worker_threads;
+    opts.max_blocking_threads = options.max_blocking_threads;
+    opts.cpu_affinity = options.cpu_affinity.empty() ? nullptr : options.cpu_affinity.data();
+    opts.num_cpu_affinity = options.cpu_affinity.size();
+    opts.index_cache_size = options.index_cache_size;
+    opts.metadata_cache_size = options.metadata_cache_size;
+    hnd_ = lancedb_init_with_options(uri, &opts);
+    is_inited_ = hnd_ != nullptr;
+  }
+
   bool IsInited() const { return is_inited_; }
+  lancedb_handle_t GetHandle() const { return hnd_; }
 
   ~LanceDB() {
     if (hnd_ == nullptr) {
@@ -95,6 +127,23 @@ public:
     bool         nullable      = false;
   };
 
+  // Lance write parameters, see lancedb_write_options_t. Fields left 0 use the default.
+  struct WriteOptions {
+    size_t max_rows_per_file  = 0;
+    size_t max_rows_per_group = 0;
+    size_t max_bytes_per_file = 0;
+    bool   overwrite          = false;
+  };
+
+  static lancedb_write_options_t GetCWriteOptions(const WriteOptions& options) {
+    lancedb_write_options_t opts;
+    opts.max_rows_per_file = options.max_rows_per_file;
+    opts.max_rows_per_group = options.max_rows_per_group;
+    opts.max_bytes_per_file = options.max_bytes_per_file;
+    opts.mode = options.overwrite ? kLanceDBWriteModeOverwrite : kLanceDBWriteModeAppend;
+    return opts;
+  }
+
   template <class T> using List = std::vector<T>;
   template <class T> using VectorList = List<List<T>>;
 
@@ -102,6 +151,54 @@ public:
     List<Field> fields;
   };
 
+  // An opened table. Inserts and queries through a Table reuse the opened table
+  // instead of opening it by name on every call.
+  class Table {
+  public:
+    Table() = default;
+    Table(const Table&) = delete;
+    Table& operator=(const Table&) = delete;
+    Table(Table&& other) noexcept { *this = std::move(other); }
+    Table& operator=(Table&& other) noexcept {
+      if (this != &other) {
+        Close();
+        hnd_ = other.hnd_;
+        name_ = std::move(other.name_);
+        other.hnd_ = nullptr;
+      }
+      return *this;
+    }
+    ~Table() { Close(); }
+
+    bool IsOpened() const { return hnd_ != nullptr; }
+    const std::string& GetName() const { return name_; }
+    lancedb_table_handle_t GetHandle() const { return hnd_; }
+
+    void Close() {
+      if (hnd_ == nullptr) {
+        return;
+      }
+      lancedb_table_close(hnd_);
+      hnd_ = nullptr;
+    }
+
+  private:
+    lancedb_table_handle_t hnd_ = nullptr;
+    std::string name_;
+
+    friend class LanceDB;
+  };
+
+  LanceDBError OpenTable(const std::string& table_name, Table& table) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    table.Close();
+    table.hnd_ = lancedb_open_table(hnd_, table_name.c_str());
+    table.name_ = table_name;
+    return table.hnd_ != nullptr ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
   template<class T>
   struct IsStringType {
     static constexpr bool value = std::is_same_v<T, std::string> ||
@@ -109,10 +206,17 @@ public:
                                   std::is_same_v<T, char*>;
   };
 
+  // Element types of query vectors, which have to be that of the searched column.
+  template <class T>
+  struct IsQueryElementType {
+    static constexpr bool value = std::is_same_v<T, Float16> || std::is_same_v<T, float> ||
+                                  std::is_same_v<T, double>;
+  };
+
   template <class T>
   struct IsScalarType {
     static constexpr bool value = std::is_scalar_v<T> || IsStringType<T>::value
-        || std::is_same_v<T, BinaryData>;
+        || std::is_same_v<T, BinaryData> || std::is_same_v<T, Float16>;
   };
 
   template <class T, template <class U> class Container>
@@ -128,9 +232,42 @@ public:
     const Field& GetFieldInfo() const { return field_info; }
     size_t GetDataCount() const { return data.size(); }
 
+    // Contiguous layout of string and blob data: all the values in one buffer, and
+    // data_count + 1 offsets into it. Empty for other types.
+    const std::vector<uint8_t>& GetValues() const { return values_holder; }
+    const std::vector<size_t>& GetOffsets() const { return offsets_holder; }
+
   protected:
+    template <class U = T>
+    void SetContiguousData() {
+      size_t total_size = 0;
+      for (auto& v: data) {
+        total_size += GetValueBytes<U>(v).second;
+      }
+      values_holder.clear();
+      values_holder.reserve(total_size);
+      offsets_holder.clear();
+      offsets_holder.reserve(data.size() + 1);
+      offsets_holder.push_back(0);
+      for (auto& v: data) {
+        auto bytes = GetValueBytes<U>(v);
+        values_holder.insert(values_holder.end(), bytes.first, bytes.first + bytes.second);
+        offsets_holder.push_back(values_holder.size());
+      }
+    }
+
+    template <class U>
+    static std::pair<const uint8_t*, size_t> GetValueBytes(const U& v) {
+      if constexpr (std::is_same_v<U, std::string>) {
+        return { reinterpret_cast<const uint8_t*>(v.data()), v.size() };
+      } else {
+        return { v.data.data(), v.data.size() };
+      }
+    }
+
+  public:
     template<class U>
-    DataType GetDataTypeByNativeType() const {
+    static DataType GetDataTypeByNativeType() {
       if constexpr (std::is_same_v<U, int8_t> || std::is_same_v<U, char> || std::is_same_v<U, unsigned char>) {
         return kLanceDBFieldTypeInt8;
       } else if constexpr (std::is_same_v<U, int16_t>) {
@@ -147,6 +284,8 @@ public:
         return kLanceDBFieldTypeUInt32;
       } else if constexpr (std::is_same_v<U, uint64_t>) {
         return kLanceDBFieldTypeUInt64;
+      } else if constexpr (std::is_same_v<U, Float16>) {
+        return kLanceDBFieldTypeFloat16;
       } else if constexpr (std::is_same_v<U, float>) {
         return kLanceDBFieldTypeFloat32;
       } else if constexpr (std::is_same_v<U, double>) {
@@ -166,6 +305,8 @@ public:
     Container<T> data;
     Field field_info;
     bool data_valid = false;
+    std::vector<uint8_t> values_holder;
+    std::vector<size_t> offsets_holder;
   };
 
   template <class T, template<class X> class Container>
@@ -180,6 +321,15 @@ public:
       SetFieldType();
     }
 
+    FieldData(const std::string& name, Container<T>&& data, bool nullable = false,
+              bool create_index = false) {
+      BaseFieldData<T, Container>::field_info.name = name;
+      BaseFieldData<T, Container>::data = std::move(data);
+      BaseFieldData<T, Container>::field_info.nullable = nullable;
+      BaseFieldData<T, Container>::field_info.create_index = create_index;
+      SetFieldType();
+    }
+
     template <class U = T>
     std::enable_if_t<IsScalarType<typename U::value_type>::value && !std::is_same_v<U, std::string>>
     SetFieldType() {
@@ -227,40 +377,35 @@ public:
 
     typedef typename InnerValueType<T>::real_type RealInnerType;
 
+    // scalars held in a std::vector are passed as they are, see GetFlattenData
     template <class U = RealInnerType>
     std::enable_if_t<!std::is_same_v<U, std::string> && !std::is_same_v<U, BinaryData>>
     SetFlattenData() {
-      flatten_data = this->data;
+      if constexpr (!std::is_same_v<Container<T>, std::vector<InnerType>>) {
+        flatten_data.assign(this->data.begin(), this->data.end());
+      }
     }
 
+    // strings and blobs are passed in the contiguous layout, see GetValues
     template <class U = RealInnerType>
-    std::enable_if_t<std::is_same_v<U, std::string>>
+    std::enable_if_t<std::is_same_v<U, std::string> || std::is_same_v<U, BinaryData>>
     SetFlattenData() {
-      for (std::string& str: BaseFieldData<T, Container>::data) {
-        flatten_data.push_back(str.c_str());
-      }
+      this->SetContiguousData();
     }
 
+    // not for strings and blobs, which are read with GetValues and GetOffsets
     template <class U = RealInnerType>
-    std::enable_if_t<std::is_same_v<U, BinaryData>>
-    SetFlattenData() {
-      for (BinaryData& bin: BaseFieldData<T, Container>::data) {
-        flatten_data.push_back(bin.data.data());
-        data_size_holder.push_back(bin.data.size());
+    const std::enable_if_t<!std::is_same_v<U, std::string> && !std::is_same_v<U, BinaryData>, std::vector<InnerType>> &
+    GetFlattenData() const {
+      if constexpr (std::is_same_v<Container<T>, std::vector<InnerType>>) {
+        return this->data;
+      } else {
+        return flatten_data;
       }
     }
 
-    const std::vector<InnerType>& GetFlattenData() const {
-      return flatten_data;
-    }
-
-    const std::vector<size_t>& GetBinaryDataSize() const {
-      return data_size_holder;
-    }
-
   private:
     std::vector<InnerType> flatten_data;
-    std::vector<size_t> data_size_holder; // only for Binary type for now
   };
 
   template <class T>
@@ -278,6 +423,26 @@ public:
       BaseFieldData<T, List>::field_info.create_index = create_index;
       BaseFieldData<T, List>::field_info.nullable = nullable;
       BaseFieldData<T, List>::data_valid = CheckDataValid();
+      if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, BinaryData>) {
+        this->SetContiguousData();
+      }
+    }
+
+    FlatFieldData(const std::string& name, List<T>&& data,
+                  FieldType field_type, int dimension = 1, bool nullable = false,
+                  bool create_index = false) {
+      BaseFieldData<T, List>::field_info.name = name;
+      BaseFieldData<T, List>::data = std::move(data);
+      BaseFieldData<T, List>::field_info.field_type = field_type;
+      BaseFieldData<T, List>::field_info.dimension = dimension;
+      BaseFieldData<T, List>::field_info.data_type =
+          BaseFieldData<T, List>::template GetDataTypeByNativeType<T>();
+      BaseFieldData<T, List>::field_info.create_index = create_index;
+      BaseFieldData<T, List>::field_info.nullable = nullable;
+      BaseFieldData<T, List>::data_valid = CheckDataValid();
+      if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, BinaryData>) {
+        this->SetContiguousData();
+      }
     }
 
     typedef typename InnerValueType<T>::type InnerType;
@@ -285,41 +450,13 @@ public:
 
     typedef typename InnerValueType<T>::real_type RealInnerType;
 
+    // not for strings and blobs, which are read with GetValues and GetOffsets
     template <class U = RealInnerType>
     const std::enable_if_t<!std::is_same_v<U, std::string> && !std::is_same_v<U, BinaryData>, List<T>> &
     GetFlattenData() const {
       return BaseFieldData<T, List>::data;
     }
 
-    template <class U = RealInnerType>
-    const std::enable_if_t<std::is_same_v<U, BinaryData>, List<InnerType>> &
-    GetFlattenData() const {
-      if (!data_holder.empty()) {
-        return data_holder;
-      }
-      for (auto& bin: this->data) {
-        const_cast<FlatFieldData<T>*>(this)->data_holder.push_back(bin.data.data());
-        const_cast<FlatFieldData<T>*>(this)->data_size_holder.push_back(bin.data.size());
-      }
-      return data_holder;
-    }
-
-    template <class U = RealInnerType>
-    const std::enable_if_t<std::is_same_v<U, std::string>, List<InnerType>> &
-    GetFlattenData() const {
-      if (!data_holder.empty()) {
-        return data_holder;
-      }
-      for (auto& str: this->data) {
-        const_cast<FlatFieldData<T>*>(this)->data_holder.push_back(str.c_str());
-      }
-      return data_holder;
-    }
-
-    const std::vector<size_t>& GetBinaryDataSize() const {
-      return data_size_holder;
-    }
-
   private:
     bool CheckDataValid() {
       int dim = BaseFieldData<T, List>::field_info.dimension;
@@ -344,28 +481,122 @@ public:
       }
       return true;
     }
+  };
+
+  // Read-only range over memory owned by someone else.
+  template <class T>
+  class Span {
+  public:
+    Span() = default;
+    Span(const T* data, size_t size) : data_(data), size_(size) {}
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T* begin() const { return data_; }
+    const T* end() const { return data_ + size_; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+  private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+  };
+
+  // Field data borrowing the caller's memory instead of copying it, for inserts from data
+  // already laid out as lancedb_field_data_t: `data_count` scalars, or `data_count` vectors of
+  // `dimension` values back to back. Strings and blobs (T is std::string or BinaryData) are
+  // given in the contiguous layout, as values and data_count + 1 offsets. The memory has to
+  // stay valid while the view, or an inserter made from it, is in use.
+  template <class T>
+  class FieldDataView {
+  public:
+    typedef typename InnerValueType<T>::type InnerType;
+    typedef typename InnerValueType<T>::real_type RealInnerType;
+    static_assert(IsScalarType<InnerType>::value, "must be scalar type");
+
+    FieldDataView(const std::string& name, const T* data, size_t data_count,
+                  FieldType field_type = kLanceDBFieldTypeScalar, int dimension = 1,
+                  bool nullable = false) {
+      static_assert(!std::is_same_v<T, std::string> && !std::is_same_v<T, BinaryData>,
+                    "strings and blobs are given as values and offsets");
+      SetFieldInfo(name, field_type, dimension, nullable, data_count);
+      flatten_data_ = Span<T>(data, data_count * dimension);
+      data_valid_ = data != nullptr && data_count > 0 && dimension > 0 &&
+                    (field_type == kLanceDBFieldTypeVector || dimension == 1);
+    }
+
+    // Any contiguous range (std::vector, std::array, std::span, ...) of scalars, or of
+    // vectors of `dimension` values back to back.
+    template <class Range, class = decltype(std::data(std::declval<const Range&>()))>
+    FieldDataView(const std::string& name, const Range& range,
+                  FieldType field_type = kLanceDBFieldTypeScalar, int dimension = 1,
+                  bool nullable = false)
+        : FieldDataView(name, std::data(range), dimension > 0 ? std::size(range) / dimension : 0,
+                        field_type, dimension, nullable) {
+      data_valid_ = data_valid_ && std::size(range) % dimension == 0;
+    }
+
+    FieldDataView(const std::string& name, const uint8_t* values, const size_t* offsets,
+                  size_t data_count, bool nullable = false) {
+      static_assert(std::is_same_v<T, std::string> || std::is_same_v<T, BinaryData>,
+                    "only strings and blobs have offsets");
+      SetFieldInfo(name, kLanceDBFieldTypeScalar, 1, nullable, data_count);
+      offsets_ = Span<size_t>(offsets, offsets != nullptr ? data_count + 1 : 0);
+      values_ = Span<uint8_t>(values, offsets != nullptr ? offsets[data_count] : 0);
+      data_valid_ = offsets != nullptr && data_count > 0 && (values != nullptr || offsets[data_count] == 0);
+    }
+
+    int GetDimension() const { return field_info_.dimension; }
+    const std::string& GetName() const { return field_info_.name; }
+    FieldType GetFieldType() const { return field_info_.field_type; }
+    DataType GetDataType() const { return field_info_.data_type; }
+    bool IsDataValid() const { return data_valid_; }
+    const Field& GetFieldInfo() const { return field_info_; }
+    size_t GetDataCount() const { return data_count_; }
 
-    std::vector<InnerType> data_holder;
-    std::vector<size_t> data_size_holder; // only for Binary type for now
+    const Span<T>& GetFlattenData() const { return flatten_data_; }
+    const Span<uint8_t>& GetValues() const { return values_; }
+    const Span<size_t>& GetOffsets() const { return offsets_; }
+
+  private:
+    void SetFieldInfo(const std::string& name, FieldType field_type, int dimension,
+                      bool nullable, size_t data_count) {
+      field_info_.name = name;
+      field_info_.data_type = BaseFieldData<T, List>::template GetDataTypeByNativeType<T>();
+      field_info_.field_type = field_type;
+      field_info_.dimension = dimension;
+      field_info_.nullable = nullable;
+      data_count_ = data_count;
+    }
+
+    Field field_info_;
+    size_t data_count_ = 0;
+    bool data_valid_ = false;
+    Span<T> flatten_data_;
+    Span<uint8_t> values_;
+    Span<size_t> offsets_;
   };
 
   typedef lancedb_field_data_t CFieldData;
 
   template <class FieldDataType>
   static CFieldData GetCFieldData(const FieldDataType& fd) {
-    CFieldData cfd;
+    CFieldData cfd = {};
     const Field& field_info = fd.GetFieldInfo();
     cfd.name = field_info.name.c_str();
     cfd.data_type = field_info.data_type;
     cfd.field_type = field_info.field_type;
     cfd.data_count = fd.GetDataCount();
     cfd.dimension = field_info.dimension;
-    if constexpr (std::is_same_v<typename FieldDataType::RealInnerType, BinaryData>) {
-      cfd.data = const_cast<void*>(reinterpret_cast<const void*>(fd.GetFlattenData().data()));
-      cfd.binary_size = const_cast<size_t*>(const_cast<FieldDataType*>(&fd)->GetBinaryDataSize().data());
+    if constexpr (std::is_same_v<typename FieldDataType::RealInnerType, BinaryData> ||
+                  std::is_same_v<typename FieldDataType::RealInnerType, std::string>) {
+      cfd.data = const_cast<uint8_t*>(fd.GetValues().data());
+      cfd.binary_size = nullptr;
+      cfd.offsets = const_cast<size_t*>(fd.GetOffsets().data());
     } else {
       cfd.data = const_cast<void*>(reinterpret_cast<const void*>(fd.GetFlattenData().data()));
       cfd.binary_size = nullptr;
+      cfd.offsets = nullptr;
     }
     return cfd;
   }
@@ -382,6 +613,75 @@ public:
     return cf;
   }
 
+#if LANCEDB_HAS_COROUTINE
+  struct SearchResults;
+
+  // Awaitables over the asynchronous C API. `start` queues the request with the given
+  // callback and user data, and returns false if it could not be queued. The awaiting
+  // coroutine is resumed on `executor`, or on the runtime worker thread if it is null.
+  class SearchAwaiter {
+  public:
+    template <class Start>
+    SearchAwaiter(Start&& start, SearchResults& sr, Executor* executor)
+        : start_(std::forward<Start>(start)), sr_(&sr), executor_(executor) {}
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> waiter) {
+      waiter_ = waiter;
+      // the awaiter may be gone once the request is queued, do not touch members after it
+      auto start = std::move(start_);
+      return start(&SearchAwaiter::OnDone, this);
+    }
+    bool await_resume() const noexcept { return success_; }
+
+  private:
+    static void OnDone(void* user_data, bool success, lancedb_data_t* search_results) {
+      auto* self = static_cast<SearchAwaiter*>(user_data);
+      self->sr_->Reset();
+      if (success) {
+        self->sr_->data_ = *search_results;
+      }
+      self->sr_->is_valid_ = success;
+      self->success_ = success;
+      internal::ResumeOn(self->executor_, self->waiter_);
+    }
+
+    std::function<bool(lancedb_search_callback_t, void*)> start_;
+    SearchResults* sr_;
+    Executor* executor_;
+    std::coroutine_handle<> waiter_;
+    bool success_ = false;
+  };
+
+  class InsertAwaiter {
+  public:
+    template <class Start>
+    InsertAwaiter(Start&& start, Executor* executor)
+        : start_(std::forward<Start>(start)), executor_(executor) {}
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> waiter) {
+      waiter_ = waiter;
+      // the awaiter may be gone once the request is queued, do not touch members after it
+      auto start = std::move(start_);
+      return start(&InsertAwaiter::OnDone, this);
+    }
+    bool await_resume() const noexcept { return success_; }
+
+  private:
+    static void OnDone(void* user_data, bool success) {
+      auto* self = static_cast<InsertAwaiter*>(user_data);
+      self->success_ = success;
+      internal::ResumeOn(self->executor_, self->waiter_);
+    }
+
+    std::function<bool(lancedb_insert_callback_t, void*)> start_;
+    Executor* executor_;
+    std::coroutine_handle<> waiter_;
+    bool success_ = false;
+  };
+#endif // LANCEDB_HAS_COROUTINE
+
   template <class... FieldDataTypes>
   class BatchInserter {
   private:
@@ -413,6 +713,44 @@ public:
       return result ? kLanceDBSuccess : kLanceDBInternalError;
     }
 
+    // Creates the table with the rows of the inserter, in a single commit.
+    LanceDBError CreateTableWithData(const std::string& table_name) {
+      return CreateTableWithData(table_name, WriteOptions());
+    }
+
+    LanceDBError CreateTableWithData(const std::string& table_name, const WriteOptions& options) {
+      if (hnd_ == nullptr) {
+        return kLanceDBNotConnected;
+      }
+      if (!is_valid_) {
+        return kLanceDBInvalidData;
+      }
+      lancedb_schema_t schema;
+      schema.fields = fields_.data();
+      schema.num_fields = fields_.size();
+      lancedb_data_t ld;
+      ld.fields = cfd_.data();
+      ld.num_fields = cfd_.size();
+      lancedb_write_options_t opts = GetCWriteOptions(options);
+      bool result = lancedb_create_table_with_data(hnd_, table_name.c_str(), &schema, &ld, &opts);
+      return result ? kLanceDBSuccess : kLanceDBInternalError;
+    }
+
+    LanceDBError Insert(const std::string& table_name, const WriteOptions& options) {
+      if (hnd_ == nullptr) {
+        return kLanceDBNotConnected;
+      }
+      if (!is_valid_) {
+        return kLanceDBInvalidData;
+      }
+      lancedb_data_t ld;
+      ld.fields = cfd_.data();
+      ld.num_fields = cfd_.size();
+      lancedb_write_options_t opts = GetCWriteOptions(options);
+      bool result = lancedb_insert_with_options(hnd_, table_name.c_str(), &ld, &opts);
+      return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
     LanceDBError Insert(const std::string& table_name) {
       if (hnd_ == nullptr) {
         return kLanceDBNotConnected;
@@ -428,6 +766,74 @@ public:
       return result ? kLanceDBSuccess : kLanceDBInsertFailed;
     }
 
+    // Merges the rows into the table by the values of `key_column`, see lancedb_upsert.
+    LanceDBError Upsert(const std::string& table_name, const std::string& key_column,
+                        lancedb_upsert_mode_t mode = kLanceDBUpsertUpdateOrInsert) {
+      if (hnd_ == nullptr) {
+        return kLanceDBNotConnected;
+      }
+      if (!is_valid_) {
+        return kLanceDBInvalidData;
+      }
+      lancedb_data_t ld;
+      ld.fields = cfd_.data();
+      ld.num_fields = cfd_.size();
+      bool result = lancedb_upsert(hnd_, table_name.c_str(), key_column.c_str(), &ld, mode);
+      return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+    LanceDBError Insert(Table& table) {
+      if (!table.IsOpened()) {
+        return kLanceDBInvalidArgument;
+      }
+      if (!is_valid_) {
+        return kLanceDBInvalidData;
+      }
+      lancedb_data_t ld;
+      ld.fields = cfd_.data();
+      ld.num_fields = cfd_.size();
+      bool result = lancedb_table_insert(table.GetHandle(), &ld);
+      return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+#if LANCEDB_HAS_COROUTINE
+    // The data is copied when the task starts, the inserter may be released before
+    // the task is awaited.
+    Task<LanceDBError> InsertAsync(const std::string& table_name, Executor* executor = nullptr) {
+      if (hnd_ == nullptr) {
+        co_return kLanceDBNotConnected;
+      }
+      if (!is_valid_) {
+        co_return kLanceDBInvalidData;
+      }
+      lancedb_data_t ld;
+      ld.fields = cfd_.data();
+      ld.num_fields = cfd_.size();
+      lancedb_handle_t hnd = hnd_;
+      bool result = co_await InsertAwaiter([&](lancedb_insert_callback_t callback, void* user_data) {
+        return lancedb_insert_async(hnd, table_name.c_str(), &ld, callback, user_data);
+      }, executor);
+      co_return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+    Task<LanceDBError> InsertAsync(Table& table, Executor* executor = nullptr) {
+      if (!table.IsOpened()) {
+        co_return kLanceDBInvalidArgument;
+      }
+      if (!is_valid_) {
+        co_return kLanceDBInvalidData;
+      }
+      lancedb_data_t ld;
+      ld.fields = cfd_.data();
+      ld.num_fields = cfd_.size();
+      lancedb_table_handle_t table_hnd = table.GetHandle();
+      bool result = co_await InsertAwaiter([&](lancedb_insert_callback_t callback, void* user_data) {
+        return lancedb_table_insert_async(table_hnd, &ld, callback, user_data);
+      }, executor);
+      co_return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+#endif // LANCEDB_HAS_COROUTINE
+
   private:
     List<CField> fields_;
     List<CFieldData> cfd_;
@@ -442,6 +848,413 @@ public:
     return BatchInserter<FieldDataTypes...>(hnd_, std::forward<FieldDataTypes>(field_data)...);
   }
 
+  // Table maintenance steps, see lancedb_optimize_options_t. Fields left 0 use the default,
+  // except prune_older_than_secs, where 0 removes every version but the latest.
+  struct OptimizeOptions {
+    bool     compact                  = true;
+    size_t   target_rows_per_fragment = 0;
+    bool     prune                    = true;
+    uint64_t prune_older_than_secs    = LANCEDB_PRUNE_DEFAULT_AGE;
+    bool     optimize_indices         = true;
+  };
+
+  LanceDBError Optimize(const std::string& table_name, lancedb_optimize_stats_t* stats = nullptr) {
+    return Optimize(table_name, OptimizeOptions(), stats);
+  }
+
+  LanceDBError Optimize(const std::string& table_name, const OptimizeOptions& options,
+                        lancedb_optimize_stats_t* stats = nullptr) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    lancedb_optimize_options_t opts;
+    opts.compact = options.compact;
+    opts.target_rows_per_fragment = options.target_rows_per_fragment;
+    opts.prune = options.prune;
+    opts.prune_older_than_secs = options.prune_older_than_secs;
+    opts.optimize_indices = options.optimize_indices;
+    bool result = lancedb_optimize(hnd_, table_name.c_str(), &opts, stats);
+    return result ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
+  // Fields left 0 use the default, see lancedb_index_options_t.
+  struct IndexOptions {
+    lancedb_distance_type_t distance_type   = kLanceDBDistanceCosine;
+    uint32_t                num_partitions  = 0;
+    uint32_t                num_sub_vectors = 0;
+  };
+
+  LanceDBError CreateIndex(const std::string& table_name, const std::string& column_name) {
+    return CreateIndex(table_name, column_name, IndexOptions());
+  }
+
+  LanceDBError CreateIndex(const std::string& table_name, const std::string& column_name,
+                           const IndexOptions& options) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    lancedb_index_options_t opts;
+    opts.distance_type = options.distance_type;
+    opts.num_partitions = options.num_partitions;
+    opts.num_sub_vectors = options.num_sub_vectors;
+    bool result = lancedb_create_index(hnd_, table_name.c_str(), column_name.c_str(), &opts);
+    return result ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
+  template <class... FieldDataTypes>
+  LanceDBError Upsert(const std::string& table_name, const std::string& key_column,
+                      lancedb_upsert_mode_t mode, FieldDataTypes&&... field_data) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    return CreateBatchInserter(std::forward<FieldDataTypes>(field_data)...).Upsert(table_name, key_column, mode);
+  }
+
+  // Buffers appended rows and commits them together, see lancedb_appender_open.
+  class Appender {
+  public:
+    // Commit thresholds, fields left 0 use the default.
+    struct Options {
+      size_t   max_rows        = 0;
+      size_t   max_bytes       = 0;
+      uint64_t max_interval_ms = 0;
+    };
+
+    Appender() = default;
+    Appender(const Appender&) = delete;
+    Appender& operator=(const Appender&) = delete;
+    Appender(Appender&& other) noexcept { *this = std::move(other); }
+    Appender& operator=(Appender&& other) noexcept {
+      if (this != &other) {
+        Close();
+        hnd_ = other.hnd_;
+        other.hnd_ = nullptr;
+      }
+      return *this;
+    }
+    ~Appender() { Close(); }
+
+    bool IsOpened() const { return hnd_ != nullptr; }
+
+    template <class... FieldDataTypes>
+    LanceDBError Append(FieldDataTypes&&... field_data) {
+      if (hnd_ == nullptr) {
+        return kLanceDBInvalidOperation;
+      }
+      std::vector<int> valid = { field_data.IsDataValid() ... };
+      for (auto v: valid) {
+        if (v == 0) {
+          return kLanceDBInvalidData;
+        }
+      }
+      std::vector<CFieldData> cfd = { GetCFieldData(field_data) ... };
+      lancedb_data_t ld;
+      ld.fields = cfd.data();
+      ld.num_fields = cfd.size();
+      bool result = lancedb_appender_append(hnd_, &ld);
+      return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+    LanceDBError Flush() {
+      if (hnd_ == nullptr) {
+        return kLanceDBInvalidOperation;
+      }
+      return lancedb_appender_flush(hnd_) ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+    // Commits the buffered rows and closes the appender.
+    LanceDBError Close() {
+      if (hnd_ == nullptr) {
+        return kLanceDBSuccess;
+      }
+      bool result = lancedb_appender_close(hnd_);
+      hnd_ = nullptr;
+      return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+  private:
+    lancedb_appender_handle_t hnd_ = nullptr;
+
+    friend class LanceDB;
+  };
+
+  LanceDBError OpenAppender(const std::string& table_name, Appender& appender) {
+    return OpenAppender(table_name, appender, Appender::Options());
+  }
+
+  LanceDBError OpenAppender(const std::string& table_name, Appender& appender,
+                            const Appender::Options& options) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    appender.Close();
+    lancedb_appender_options_t opts;
+    opts.max_rows = options.max_rows;
+    opts.max_bytes = options.max_bytes;
+    opts.max_interval_ms = options.max_interval_ms;
+    appender.hnd_ = lancedb_appender_open(hnd_, table_name.c_str(), &opts);
+    return appender.hnd_ != nullptr ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
+  // Options of ImportVectors, see lancedb_import_options_t.
+  struct ImportOptions {
+    std::string vector_column = "vector";
+    std::string id_column;  // empty for no id column
+    int64_t first_id = 0;
+    size_t dimension = 0;
+    size_t header_size = 0;
+    size_t chunk_rows = 0;
+    bool create_table = false;
+  };
+
+  // Imports all the vectors of an fvecs, npy or raw float32 file in a single commit.
+  LanceDBError ImportVectors(const std::string& table_name, const std::string& path,
+                             lancedb_vector_format_t format) {
+    return ImportVectors(table_name, path, format, ImportOptions());
+  }
+
+  LanceDBError ImportVectors(const std::string& table_name, const std::string& path,
+                             lancedb_vector_format_t format, const ImportOptions& options) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    lancedb_import_options_t opts;
+    opts.vector_column = options.vector_column.c_str();
+    opts.id_column = options.id_column.empty() ? nullptr : options.id_column.c_str();
+    opts.first_id = options.first_id;
+    opts.dimension = options.dimension;
+    opts.header_size = options.header_size;
+    opts.chunk_rows = options.chunk_rows;
+    opts.create_table = options.create_table ? 1 : 0;
+    bool result = lancedb_import_vectors(hnd_, table_name.c_str(), path.c_str(), format, &opts);
+    return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+  }
+
+  // Write buffer shared by many writer threads, see lancedb_write_buffer_open.
+  class WriteBuffer {
+  public:
+    // Fields left 0 use the default.
+    struct Options {
+      uint64_t flush_interval_ms = 0;
+      size_t   max_rows          = 0;
+      bool     wait_for_commit   = false; // return from Write once the rows are committed
+    };
+
+    WriteBuffer() = default;
+    WriteBuffer(const WriteBuffer&) = delete;
+    WriteBuffer& operator=(const WriteBuffer&) = delete;
+    WriteBuffer(WriteBuffer&& other) noexcept { *this = std::move(other); }
+    WriteBuffer& operator=(WriteBuffer&& other) noexcept {
+      if (this != &other) {
+        Close();
+        hnd_ = other.hnd_;
+        other.hnd_ = nullptr;
+      }
+      return *this;
+    }
+    ~WriteBuffer() { Close(); }
+
+    bool IsOpened() const { return hnd_ != nullptr; }
+
+    // Can be called from several threads at once.
+    template <class... FieldDataTypes>
+    LanceDBError Write(FieldDataTypes&&... field_data) {
+      if (hnd_ == nullptr) {
+        return kLanceDBInvalidOperation;
+      }
+      std::vector<int> valid = { field_data.IsDataValid() ... };
+      for (auto v: valid) {
+        if (v == 0) {
+          return kLanceDBInvalidData;
+        }
+      }
+      std::vector<CFieldData> cfd = { GetCFieldData(field_data) ... };
+      lancedb_data_t ld;
+      ld.fields = cfd.data();
+      ld.num_fields = cfd.size();
+      bool result = lancedb_write_buffer_write(hnd_, &ld);
+      return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+    LanceDBError Flush() {
+      if (hnd_ == nullptr) {
+        return kLanceDBInvalidOperation;
+      }
+      return lancedb_write_buffer_flush(hnd_) ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+    LanceDBError GetStats(lancedb_write_buffer_stats_t& stats) const {
+      if (hnd_ == nullptr) {
+        return kLanceDBInvalidOperation;
+      }
+      return lancedb_write_buffer_get_stats(hnd_, &stats) ? kLanceDBSuccess : kLanceDBInternalError;
+    }
+
+    // Commits the queued rows and closes the write buffer.
+    LanceDBError Close() {
+      if (hnd_ == nullptr) {
+        return kLanceDBSuccess;
+      }
+      bool result = lancedb_write_buffer_close(hnd_);
+      hnd_ = nullptr;
+      return result ? kLanceDBSuccess : kLanceDBInsertFailed;
+    }
+
+  private:
+    lancedb_write_buffer_handle_t hnd_ = nullptr;
+
+    friend class LanceDB;
+  };
+
+  LanceDBError OpenWriteBuffer(const std::string& table_name, WriteBuffer& write_buffer) {
+    return OpenWriteBuffer(table_name, write_buffer, WriteBuffer::Options());
+  }
+
+  LanceDBError OpenWriteBuffer(const std::string& table_name, WriteBuffer& write_buffer,
+                               const WriteBuffer::Options& options) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    write_buffer.Close();
+    lancedb_write_buffer_options_t opts;
+    opts.flush_interval_ms = options.flush_interval_ms;
+    opts.max_rows = options.max_rows;
+    opts.durability = options.wait_for_commit ? kLanceDBDurabilityCommitted : kLanceDBDurabilityEnqueued;
+    write_buffer.hnd_ = lancedb_write_buffer_open(hnd_, table_name.c_str(), &opts);
+    return write_buffer.hnd_ != nullptr ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
+  // Long-lived inserter of an opened table, which commits in the background: Submit queues a
+  // batch and returns once its data is copied, so the caller can fill the next batch in the
+  // same buffers while this one is written. At most one batch is being committed, Submit
+  // waits for the previous one first. The fields of the first batch are kept, later batches
+  // must have the same fields in the same order.
+  class BackgroundInserter {
+  public:
+    BackgroundInserter() = default;
+    BackgroundInserter(const BackgroundInserter&) = delete;
+    BackgroundInserter& operator=(const BackgroundInserter&) = delete;
+    BackgroundInserter(BackgroundInserter&& other) noexcept { *this = std::move(other); }
+    BackgroundInserter& operator=(BackgroundInserter&& other) noexcept {
+      if (this != &other) {
+        Close();
+        table_ = std::move(other.table_);
+        state_ = std::move(other.state_);
+        fields_ = std::move(other.fields_);
+        cfd_ = std::move(other.cfd_);
+      }
+      return *this;
+    }
+    ~BackgroundInserter() { Close(); }
+
+    bool IsOpened() const { return table_.IsOpened(); }
+
+    // Returns the result of the previous batch if it failed, the batch is not queued then.
+    template <class... FieldDataTypes>
+    LanceDBError Submit(FieldDataTypes&&... field_data) {
+      if (!IsOpened()) {
+        return kLanceDBInvalidOperation;
+      }
+      std::vector<bool> valid = { field_data.IsDataValid() ... };
+      for (bool v: valid) {
+        if (!v) {
+          return kLanceDBInvalidData;
+        }
+      }
+      if (fields_.empty()) {
+        fields_ = { field_data.GetFieldInfo() ... };
+        cfd_.resize(fields_.size());
+      } else if (!SameFields({ &field_data.GetFieldInfo() ... })) {
+        return kLanceDBInvalidArgument;
+      }
+      LanceDBError ret = Wait();
+      if (ret != kLanceDBSuccess) {
+        return ret;
+      }
+
+      // the field data vector is reused, only the data changes from one batch to the next
+      size_t i = 0;
+      ( (cfd_[i++] = GetCFieldData(field_data)), ... );
+      lancedb_data_t ld;
+      ld.fields = cfd_.data();
+      ld.num_fields = cfd_.size();
+      state_->pending = true;
+      if (!lancedb_table_insert_async(table_.GetHandle(), &ld, &BackgroundInserter::OnDone, state_.get())) {
+        state_->pending = false;
+        return kLanceDBInsertFailed;
+      }
+      return kLanceDBSuccess;
+    }
+
+    // Waits for the batch being committed, and returns its result.
+    LanceDBError Wait() {
+      if (state_ == nullptr) {
+        return kLanceDBSuccess;
+      }
+      std::unique_lock<std::mutex> lock(state_->mutex);
+      state_->cond.wait(lock, [this]() { return !state_->pending; });
+      LanceDBError ret = state_->result;
+      state_->result = kLanceDBSuccess;
+      return ret;
+    }
+
+    // Waits for the batch being committed and closes the table.
+    LanceDBError Close() {
+      LanceDBError ret = Wait();
+      table_.Close();
+      state_.reset();
+      fields_.clear();
+      cfd_.clear();
+      return ret;
+    }
+
+  private:
+    struct State {
+      std::mutex mutex;
+      std::condition_variable cond;
+      bool pending = false;
+      LanceDBError result = kLanceDBSuccess;
+    };
+
+    static void OnDone(void* user_data, bool success) {
+      auto* state = static_cast<State*>(user_data);
+      std::lock_guard<std::mutex> lock(state->mutex);
+      state->pending = false;
+      state->result = success ? kLanceDBSuccess : kLanceDBInsertFailed;
+      state->cond.notify_all();
+    }
+
+    bool SameFields(const std::vector<const Field*>& fields) const {
+      if (fields.size() != fields_.size()) {
+        return false;
+      }
+      for (size_t i = 0; i < fields.size(); i++) {
+        if (fields[i]->name != fields_[i].name || fields[i]->data_type != fields_[i].data_type ||
+            fields[i]->field_type != fields_[i].field_type || fields[i]->dimension != fields_[i].dimension) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    Table table_;
+    std::unique_ptr<State> state_;
+    List<Field> fields_;
+    List<CFieldData> cfd_;
+
+    friend class LanceDB;
+  };
+
+  LanceDBError OpenBackgroundInserter(const std::string& table_name, BackgroundInserter& inserter) {
+    inserter.Close();
+    LanceDBError ret = OpenTable(table_name, inserter.table_);
+    if (ret != kLanceDBSuccess) {
+      return ret;
+    }
+    inserter.state_ = std::make_unique<BackgroundInserter::State>();
+    return kLanceDBSuccess;
+  }
+
   struct SearchResults {
   public:
     SearchResults() = default;
@@ -452,37 +1265,322 @@ public:
       lancedb_free_search_results(&data_);
     }
 
+    // The results own C memory: they can be moved, not copied.
+    SearchResults(const SearchResults&) = delete;
+    SearchResults& operator=(const SearchResults&) = delete;
+
+    SearchResults(SearchResults&& other) noexcept : data_(other.data_), is_valid_(other.is_valid_) {
+      other.data_ = lancedb_data_t{ nullptr, 0 };
+      other.is_valid_ = false;
+    }
+
+    SearchResults& operator=(SearchResults&& other) noexcept {
+      if (this != &other) {
+        Reset();
+        data_ = other.data_;
+        is_valid_ = other.is_valid_;
+        other.data_ = lancedb_data_t{ nullptr, 0 };
+        other.is_valid_ = false;
+      }
+      return *this;
+    }
+
     const lancedb_data_t& Get() const { return data_; }
     bool IsValid() const { return is_valid_; }
   private:
+    // frees the results held, before the object is filled again
+    void Reset() {
+      if (is_valid_) {
+        lancedb_free_search_results(&data_);
+      }
+      data_ = lancedb_data_t{ nullptr, 0 };
+      is_valid_ = false;
+    }
 
-    lancedb_data_t data_;
+    lancedb_data_t data_ = { nullptr, 0 };
     bool is_valid_ = false;
 
     friend class LanceDB;
   };
 
+  // SQL predicate for SearchOptions::filter. Column names are quoted and string values
+  // escaped, so values coming from users cannot change the meaning of the filter:
+  //   auto filter = Filter::Eq("tenant_id", 42) && Filter::Ge("time", start_time);
+  //   options.filter = filter.ToString();
+  class Filter {
+  public:
+    template <class T> static Filter Eq(const std::string& column, const T& value) { return Compare(column, "=", value); }
+    template <class T> static Filter Ne(const std::string& column, const T& value) { return Compare(column, "!=", value); }
+    template <class T> static Filter Lt(const std::string& column, const T& value) { return Compare(column, "<", value); }
+    template <class T> static Filter Le(const std::string& column, const T& value) { return Compare(column, "<=", value); }
+    template <class T> static Filter Gt(const std::string& column, const T& value) { return Compare(column, ">", value); }
+    template <class T> static Filter Ge(const std::string& column, const T& value) { return Compare(column, ">=", value); }
+
+    template <class T>
+    static Filter In(const std::string& column, const std::vector<T>& values) {
+      if (values.empty()) {
+        return Filter("FALSE");
+      }
+      std::string expr = QuoteColumn(column) + " IN (";
+      for (size_t i = 0; i < values.size(); i++) {
+        expr += (i == 0 ? "" : ", ") + Literal(values[i]);
+      }
+      return Filter(expr + ")");
+    }
+
+    static Filter IsNull(const std::string& column) { return Filter(QuoteColumn(column) + " IS NULL"); }
+    static Filter IsNotNull(const std::string& column) { return Filter(QuoteColumn(column) + " IS NOT NULL"); }
+
+    // Predicate used as is, it is not escaped.
+    static Filter Sql(const std::string& expr) { return Filter(expr); }
+
+    friend Filter operator&&(const Filter& a, const Filter& b) { return Filter("(" + a.expr_ + ") AND (" + b.expr_ + ")"); }
+    friend Filter operator||(const Filter& a, const Filter& b) { return Filter("(" + a.expr_ + ") OR (" + b.expr_ + ")"); }
+    friend Filter operator!(const Filter& a) { return Filter("NOT (" + a.expr_ + ")"); }
+
+    const std::string& ToString() const { return expr_; }
+
+    static std::string QuoteColumn(const std::string& column) {
+      return Quote(column, '`');
+    }
+
+    static std::string Literal(const std::string& value) { return Quote(value, '\''); }
+    static std::string Literal(const char* value) { return Quote(value, '\''); }
+    static std::string Literal(bool value) { return value ? "TRUE" : "FALSE"; }
+
+    template <class T>
+    static std::enable_if_t<std::is_arithmetic<T>::value, std::string> Literal(T value) {
+      std::ostringstream ss;
+      ss.imbue(std::locale::classic());
+      if (std::is_floating_point<T>::value) {
+        ss.precision(std::numeric_limits<T>::max_digits10);
+      }
+      // print int8_t and uint8_t as numbers
+      ss << +value;
+      return ss.str();
+    }
+
+  private:
+    explicit Filter(std::string expr) : expr_(std::move(expr)) {}
+
+    template <class T>
+    static Filter Compare(const std::string& column, const char* op, const T& value) {
+      return Filter(QuoteColumn(column) + " " + op + " " + Literal(value));
+    }
+
+    // Encloses `value` in `quote`, doubling the quotes inside it.
+    static std::string Quote(const std::string& value, char quote) {
+      std::string quoted(1, quote);
+      for (char c: value) {
+        if (c == quote) {
+          quoted += quote;
+        }
+        quoted += c;
+      }
+      return quoted + quote;
+    }
+
+    std::string expr_;
+  };
+
+  // Fields left 0 use the default, see lancedb_search_options_t.
+  struct SearchOptions {
+    size_t                  limit         = 0;
+    size_t                  nprobes       = 0;
+    uint32_t                refine_factor = 0;
+    lancedb_distance_type_t distance_type = kLanceDBDistanceCosine;
+    std::vector<std::string> select_columns; // empty for all the columns
+    std::string              filter;         // empty for none, see Filter
+    bool                     prefilter     = true;
+  };
+
+  // `column_names` holds the selected column names the C options point to.
+  static lancedb_search_options_t GetCSearchOptions(const SearchOptions& options,
+                                                    std::vector<const char*>& column_names) {
+    lancedb_search_options_t opts;
+    opts.limit = options.limit;
+    opts.nprobes = options.nprobes;
+    opts.refine_factor = options.refine_factor;
+    opts.distance_type = options.distance_type;
+    column_names.clear();
+    for (const std::string& name: options.select_columns) {
+      column_names.push_back(name.c_str());
+    }
+    opts.select_columns = column_names.empty() ? nullptr : column_names.data();
+    opts.num_select_columns = column_names.size();
+    opts.filter = options.filter.empty() ? nullptr : options.filter.c_str();
+    opts.postfilter = !options.prefilter;
+    return opts;
+  }
+
   template <class T>
-  std::enable_if_t<std::is_same_v<T, float> || std::is_same_v<T, double>, LanceDBError>
+  std::enable_if_t<IsQueryElementType<T>::value, LanceDBError>
   Query(const std::string& table_name, const std::string& column_name, const std::vector<T>& embeddings,
         SearchResults& sr) {
+    return Query(table_name, column_name, embeddings, SearchOptions(), sr);
+  }
+
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, LanceDBError>
+  Query(const std::string& table_name, const std::string& column_name, const std::vector<T>& embeddings,
+        const SearchOptions& options, SearchResults& sr) {
     if (hnd_ == nullptr) {
       return kLanceDBNotConnected;
     }
     if (embeddings.empty()) {
       return kLanceDBInvalidData;
     }
+    sr.Reset();
+    lancedb_data_t& result_data = sr.data_;
+    std::vector<const char*> column_names;
+    lancedb_search_options_t opts = GetCSearchOptions(options, column_names);
+    bool result = lancedb_search_with_options(hnd_, table_name.c_str(), column_name.c_str(),
+                                              (void*)embeddings.data(), embeddings.size(), &opts,
+                                              &result_data);
+    sr.is_valid_ = result;
+    return result ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, LanceDBError>
+  Query(Table& table, const std::string& column_name, const std::vector<T>& embeddings,
+        SearchResults& sr) {
+    return Query(table, column_name, embeddings, SearchOptions(), sr);
+  }
+
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, LanceDBError>
+  Query(Table& table, const std::string& column_name, const std::vector<T>& embeddings,
+        const SearchOptions& options, SearchResults& sr) {
+    if (!table.IsOpened()) {
+      return kLanceDBInvalidArgument;
+    }
+    if (embeddings.empty()) {
+      return kLanceDBInvalidData;
+    }
+    sr.Reset();
     lancedb_data_t& result_data = sr.data_;
-    bool result = lancedb_search(hnd_, table_name.c_str(), column_name.c_str(),
-                                 (void*)embeddings.data(), embeddings.size(), &result_data);
+    std::vector<const char*> column_names;
+    lancedb_search_options_t opts = GetCSearchOptions(options, column_names);
+    bool result = lancedb_table_search_with_options(table.GetHandle(), column_name.c_str(),
+                                                    (void*)embeddings.data(), embeddings.size(),
+                                                    &opts, &result_data);
     sr.is_valid_ = result;
     return result ? kLanceDBSuccess : kLanceDBInternalError;
   }
+
+  // Runs all the queries in one call, in parallel, see lancedb_search_batch. The queries must
+  // have the same dimension. `results` gets one entry per query, in the order of the queries;
+  // on failure, the entries of the failed queries are not valid.
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, LanceDBError>
+  QueryBatch(const std::string& table_name, const std::string& column_name,
+             const std::vector<std::vector<T>>& queries, std::vector<SearchResults>& results) {
+    return QueryBatch(table_name, column_name, queries, SearchOptions(), results);
+  }
+
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, LanceDBError>
+  QueryBatch(const std::string& table_name, const std::string& column_name,
+             const std::vector<std::vector<T>>& queries, const SearchOptions& options,
+             std::vector<SearchResults>& results) {
+    if (hnd_ == nullptr) {
+      return kLanceDBNotConnected;
+    }
+    if (queries.empty() || queries[0].empty()) {
+      return kLanceDBInvalidData;
+    }
+    size_t dimension = queries[0].size();
+    std::vector<T> data;
+    data.reserve(queries.size() * dimension);
+    for (const auto& query: queries) {
+      if (query.size() != dimension) {
+        return kLanceDBInvalidData;
+      }
+      data.insert(data.end(), query.begin(), query.end());
+    }
+
+    std::vector<lancedb_data_t> result_data(queries.size());
+    std::vector<const char*> column_names;
+    lancedb_search_options_t opts = GetCSearchOptions(options, column_names);
+    bool result = lancedb_search_batch(hnd_, table_name.c_str(), column_name.c_str(), (void*)data.data(),
+                                       queries.size(), dimension, &opts, result_data.data());
+    // only the failed queries have no fields, they are left invalid
+    results.clear();
+    results.resize(queries.size());
+    for (size_t i = 0; i < queries.size(); i++) {
+      results[i].data_ = result_data[i];
+      results[i].is_valid_ = result || result_data[i].fields != nullptr;
+    }
+    return result ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
+#if LANCEDB_HAS_COROUTINE
+  // `embeddings` and `sr` have to stay alive until the task is finished. `options` are copied
+  // when the search is queued, before the task first suspends.
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, Task<LanceDBError>>
+  QueryAsync(const std::string& table_name, const std::string& column_name, const std::vector<T>& embeddings,
+             SearchResults& sr, Executor* executor = nullptr) {
+    return QueryAsync(table_name, column_name, embeddings, SearchOptions(), sr, executor);
+  }
+
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, Task<LanceDBError>>
+  QueryAsync(const std::string& table_name, const std::string& column_name, const std::vector<T>& embeddings,
+             const SearchOptions& options, SearchResults& sr, Executor* executor = nullptr) {
+    if (hnd_ == nullptr) {
+      co_return kLanceDBNotConnected;
+    }
+    if (embeddings.empty()) {
+      co_return kLanceDBInvalidData;
+    }
+    lancedb_handle_t hnd = hnd_;
+    std::vector<const char*> column_names;
+    lancedb_search_options_t opts = GetCSearchOptions(options, column_names);
+    bool result = co_await SearchAwaiter([&](lancedb_search_callback_t callback, void* user_data) {
+      return lancedb_search_async_with_options(hnd, table_name.c_str(), column_name.c_str(),
+                                               (void*)embeddings.data(), embeddings.size(), &opts,
+                                               callback, user_data);
+    }, sr, executor);
+    co_return result ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, Task<LanceDBError>>
+  QueryAsync(Table& table, const std::string& column_name, const std::vector<T>& embeddings,
+             SearchResults& sr, Executor* executor = nullptr) {
+    return QueryAsync(table, column_name, embeddings, SearchOptions(), sr, executor);
+  }
+
+  template <class T>
+  std::enable_if_t<IsQueryElementType<T>::value, Task<LanceDBError>>
+  QueryAsync(Table& table, const std::string& column_name, const std::vector<T>& embeddings,
+             const SearchOptions& options, SearchResults& sr, Executor* executor = nullptr) {
+    if (!table.IsOpened()) {
+      co_return kLanceDBInvalidArgument;
+    }
+    if (embeddings.empty()) {
+      co_return kLanceDBInvalidData;
+    }
+    lancedb_table_handle_t table_hnd = table.GetHandle();
+    std::vector<const char*> column_names;
+    lancedb_search_options_t opts = GetCSearchOptions(options, column_names);
+    bool result = co_await SearchAwaiter([&](lancedb_search_callback_t callback, void* user_data) {
+      return lancedb_table_search_async_with_options(table_hnd, column_name.c_str(),
+                                                     (void*)embeddings.data(), embeddings.size(), &opts,
+                                                     callback, user_data);
+    }, sr, executor);
+    co_return result ? kLanceDBSuccess : kLanceDBInternalError;
+  }
+#endif // LANCEDB_HAS_COROUTINE
 private:
   bool is_inited_ = false;
   lancedb_handle_t hnd_;
 };
 
+using Table = LanceDB::Table;
+
 } // namespace lancedb
 
 #endif // LANCEDB_INCLUDE_LANCEDB_HPP_
\ No newline at end of file
@@ -0,0 +1,266 @@
+#ifndef LANCEDB_INCLUDE_LANCEDB_COROUTINE_HPP_
+#define LANCEDB_INCLUDE_LANCEDB_COROUTINE_HPP_
+
+// C++20 coroutine support for the C++ API. Only available when compiled as C++20 with
+// coroutine support, LANCEDB_HAS_COROUTINE is set to 1 in that case.
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define LANCEDB_HAS_COROUTINE 1
+#else
+#define LANCEDB_HAS_COROUTINE 0
+#endif
+
+#if LANCEDB_HAS_COROUTINE
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lancedb {
+
+// Where to resume a coroutine once its request is completed. Without an executor, the
+// coroutine is resumed on the runtime worker thread that completed the request, where
+// the blocking API must not be called.
+class Executor {
+public:
+  virtual ~Executor() = default;
+  virtual void Post(std::function<void()> fn) = 0;
+};
+
+// Small fixed-size thread pool executor.
+class ThreadPoolExecutor : public Executor {
+public:
+  explicit ThreadPoolExecutor(size_t num_threads = 1) {
+    for (size_t i = 0; i < num_threads; i++) {
+      threads_.emplace_back([this]() { Run(); });
+    }
+  }
+
+  ~ThreadPoolExecutor() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopped_ = true;
+    }
+    cond_.notify_all();
+    for (auto& th: threads_) {
+      th.join();
+    }
+  }
+
+  void Post(std::function<void()> fn) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(fn));
+    }
+    cond_.notify_one();
+  }
+
+private:
+  void Run() {
+    for (;;) {
+      std::function<void()> fn;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]() { return stopped_ || !queue_.empty(); });
+        if (queue_.empty()) {
+          return;
+        }
+        fn = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      fn();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::deque<std::function<void()>> queue_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool stopped_ = false;
+};
+
+namespace internal {
+
+inline void ResumeOn(Executor* executor, std::coroutine_handle<> handle) {
+  if (executor == nullptr) {
+    handle.resume();
+    return;
+  }
+  executor->Post([handle]() { handle.resume(); });
+}
+
+// Coroutine state shared by Task<T> and Task<void>. The task starts running as soon as it
+// is created; `state_` is nullptr while running, the awaiting coroutine once one is waiting,
+// or kDone when finished, so completion and co_await may race from different threads.
+class TaskPromiseBase {
+public:
+  std::suspend_never initial_suspend() noexcept { return {}; }
+
+  struct FinalAwaiter {
+    bool await_ready() noexcept { return false; }
+    template <class Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+      void* waiter = h.promise().state_.exchange(kDone);
+      return waiter != nullptr ? std::coroutine_handle<>::from_address(waiter) : std::noop_coroutine();
+    }
+    void await_resume() noexcept {}
+  };
+
+  FinalAwaiter final_suspend() noexcept { return {}; }
+
+  void unhandled_exception() { exception_ = std::current_exception(); }
+
+  bool IsDone() const { return state_.load() == kDone; }
+
+  // Returns false if the task has finished already, and the waiter should not suspend.
+  bool SetWaiter(std::coroutine_handle<> waiter) {
+    void* expected = nullptr;
+    return state_.compare_exchange_strong(expected, waiter.address());
+  }
+
+  void RethrowIfFailed() {
+    if (exception_) {
+      std::rethrow_exception(exception_);
+    }
+  }
+
+protected:
+  inline static char done_tag_ = 0;
+  inline static void* const kDone = &done_tag_;
+
+  std::atomic<void*> state_ { nullptr };
+  std::exception_ptr exception_;
+};
+
+template <class T>
+class TaskPromise : public TaskPromiseBase {
+public:
+  void return_value(T value) { value_ = std::move(value); }
+  T TakeValue() {
+    RethrowIfFailed();
+    return std::move(*value_);
+  }
+
+private:
+  std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+  void return_void() {}
+  void TakeValue() { RethrowIfFailed(); }
+};
+
+// Fire-and-forget coroutine, used to drive a task from non-coroutine code.
+struct DetachedTask {
+  struct promise_type {
+    DetachedTask get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+} // namespace internal
+
+// Coroutine task. It starts running when created, so several tasks can be in flight at once
+// and co_awaited later. A task must be awaited (or passed to SyncWait) before it is destroyed.
+template <class T = void>
+class Task {
+public:
+  struct promise_type : public internal::TaskPromise<T> {
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+  };
+
+  Task(Task&& other) noexcept : coro_(std::exchange(other.coro_, nullptr)) {}
+  Task& operator=(Task&& other) noexcept {
+    if (this != &other) {
+      Destroy();
+      coro_ = std::exchange(other.coro_, nullptr);
+    }
+    return *this;
+  }
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() { Destroy(); }
+
+  bool IsDone() const { return coro_ && coro_.promise().IsDone(); }
+
+  struct Awaiter {
+    bool await_ready() const noexcept { return coro.promise().IsDone(); }
+    bool await_suspend(std::coroutine_handle<> waiter) { return coro.promise().SetWaiter(waiter); }
+    T await_resume() { return coro.promise().TakeValue(); }
+
+    std::coroutine_handle<promise_type> coro;
+  };
+
+  Awaiter operator co_await() const noexcept { return Awaiter { coro_ }; }
+
+private:
+  explicit Task(std::coroutine_handle<promise_type> coro) : coro_(coro) {}
+
+  void Destroy() {
+    if (coro_) {
+      coro_.destroy();
+      coro_ = nullptr;
+    }
+  }
+
+  std::coroutine_handle<promise_type> coro_;
+};
+
+// Blocks the calling thread until the task has finished, and returns its result.
+template <class T>
+T SyncWait(Task<T>& task) {
+  std::mutex mutex;
+  std::condition_variable cond;
+  bool done = false;
+  std::optional<std::conditional_t<std::is_void_v<T>, bool, T>> result;
+  std::exception_ptr error;
+  auto wait = [&]() -> internal::DetachedTask {
+    try {
+      if constexpr (std::is_void_v<T>) {
+        co_await task;
+        result.emplace(true);
+      } else {
+        result.emplace(co_await task);
+      }
+    } catch (...) {
+      error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    done = true;
+    cond.notify_all();
+  };
+  wait();
+  std::unique_lock<std::mutex> lock(mutex);
+  cond.wait(lock, [&]() { return done; });
+  if (error) {
+    std::rethrow_exception(error);
+  }
+  if constexpr (!std::is_void_v<T>) {
+    return std::move(*result);
+  }
+}
+
+template <class T>
+T SyncWait(Task<T>&& task) {
+  return SyncWait(task);
+}
+
+} // namespace lancedb
+
+#endif // LANCEDB_HAS_COROUTINE
+
+#endif // LANCEDB_INCLUDE_LANCEDB_COROUTINE_HPP_
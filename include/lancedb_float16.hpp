@@ -0,0 +1,87 @@
+#ifndef LANCEDB_INCLUDE_LANCEDB_FLOAT16_HPP_
+#define LANCEDB_INCLUDE_LANCEDB_FLOAT16_HPP_
+
+#include <cstdint>
+#include <cstring>
+
+namespace lancedb {
+
+// IEEE 754 half precision value, the element type of kLanceDBFieldTypeFloat16 fields. It has
+// the size and layout of the stored value, so arrays of it can be passed to the C API as is.
+struct Float16 {
+  uint16_t bits = 0;
+
+  Float16() = default;
+  Float16(float value) : bits(FromFloat(value)) {}
+
+  operator float() const { return ToFloat(bits); }
+
+  static Float16 FromBits(uint16_t bits) {
+    Float16 value;
+    value.bits = bits;
+    return value;
+  }
+
+  // Rounds to the nearest value, ties to even.
+  static uint16_t FromFloat(float value) {
+    uint32_t f;
+    memcpy(&f, &value, sizeof(f));
+    uint16_t sign = (f >> 16) & 0x8000;
+    uint32_t abs = f & 0x7fffffff;
+    if (abs >= 0x7f800000) {
+      // infinity, or NaN kept quiet
+      return sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 | ((abs >> 13) & 0x3ff) : 0);
+    }
+    if (abs >= 0x477ff000) {
+      // 65520 and above round to infinity
+      return sign | 0x7c00;
+    }
+    if (abs < 0x38800000) {
+      // subnormal in half precision, below 2^-25 it rounds to zero
+      if (abs < 0x33000000) {
+        return sign;
+      }
+      uint32_t shift = 126 - (abs >> 23);
+      uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+      uint32_t half = mantissa >> shift;
+      uint32_t rest = mantissa & ((1u << shift) - 1);
+      uint32_t halfway = 1u << (shift - 1);
+      if (rest > halfway || (rest == halfway && (half & 1))) {
+        half++;
+      }
+      return sign | half;
+    }
+    uint32_t half = (abs >> 13) - ((127 - 15) << 10);
+    uint32_t rest = abs & 0x1fff;
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+      half++;
+    }
+    return sign | half;
+  }
+
+  static float ToFloat(uint16_t bits) {
+    uint32_t sign = (uint32_t)(bits & 0x8000) << 16;
+    uint32_t exponent = (bits >> 10) & 0x1f;
+    uint32_t mantissa = bits & 0x3ff;
+    uint32_t f;
+    if (exponent == 0) {
+      // zero or subnormal, mantissa * 2^-24
+      float value = (float)mantissa * (1.f / 16777216.f);
+      memcpy(&f, &value, sizeof(f));
+      f |= sign;
+    } else if (exponent == 0x1f) {
+      f = sign | 0x7f800000 | (mantissa << 13);
+    } else {
+      f = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float value;
+    memcpy(&value, &f, sizeof(value));
+    return value;
+  }
+};
+
+static_assert(sizeof(Float16) == 2, "Float16 must have the size of a half precision value");
+
+} // namespace lancedb
+
+#endif // LANCEDB_INCLUDE_LANCEDB_FLOAT16_HPP_
@@ -5,6 +5,7 @@
 #include <cstdint>
 
 #include "lancedb.h"
+#include "lancedb_float16.hpp"
 
 #ifndef LANCEDB_TOOL_LOGD
 #define LANCEDB_TOOL_LOGD(fmt, ...) printf(fmt "\n", ##__VA_ARGS__)
@@ -45,8 +46,8 @@ struct LanceDBTool {
       printf("%lu\t", data[i * field.dimension + j]);
     }
     else if (field.data_type == kLanceDBFieldTypeFloat16) {
-      float* data = (float*)field.data;
-      printf("%f\t", data[i * field.dimension + j]);
+      uint16_t* data = (uint16_t*)field.data;
+      printf("%f\t", lancedb::Float16::ToFloat(data[i * field.dimension + j]));
     }
     else if (field.data_type == kLanceDBFieldTypeFloat32) {
       float* data = (float*)field.data;
@@ -56,13 +57,9 @@ struct LanceDBTool {
       double* data = (double*)field.data;
       printf("%f\t", data[i * field.dimension + j]);
     }
-    else if (field.data_type == kLanceDBFieldTypeString) {
-      const char** data = (const char**)field.data;
-      printf("%s\t", data[i * field.dimension]);
-    }
-    else if (field.data_type == kLanceDBFieldTypeBlob) {
-      const char** data = (const char**)field.data;
-      printf("%s\t", data[i * field.dimension]);
+    else if (field.data_type == kLanceDBFieldTypeString || field.data_type == kLanceDBFieldTypeBlob) {
+      const char* data = (const char*)field.data;
+      printf("%.*s\t", (int)(field.offsets[i + 1] - field.offsets[i]), data + field.offsets[i]);
     }
     else if (field.data_type == kLanceDBFieldTypeTimestamp) {
       int64_t* data = (int64_t*)field.data;
@@ -79,7 +76,7 @@ struct LanceDBTool {
       LANCEDB_TOOL_LOGD("   data_count: %zd", result_data.fields[i].data_count);
       LANCEDB_TOOL_LOGD("   dimension:  %zd", result_data.fields[i].dimension);
       LANCEDB_TOOL_LOGD("   data:       %p", result_data.fields[i].data);
-      LANCEDB_TOOL_LOGD("   binary_size: %p", result_data.fields[i].binary_size);
+      LANCEDB_TOOL_LOGD("   offsets:    %p", result_data.fields[i].offsets);
       LANCEDB_TOOL_LOGD("   field_type: %d", result_data.fields[i].field_type);
 
       if (field.data == nullptr) {
@@ -92,8 +89,8 @@ struct LanceDBTool {
         for (int j=0; j<field.data_count; j++) {
           printf("[%3d] ", j);
           if (field.data_type == kLanceDBFieldTypeString) {
-            const char* data = ((const char**)field.data)[j];
-            size_t datasize = field.binary_size[j];
+            const char* data = (const char*)field.data + field.offsets[j];
+            size_t datasize = field.offsets[j + 1] - field.offsets[j];
             printf("(length: %5zd) ", datasize);
             for (int k=0; k<datasize; k++) {
               printf("%c", data[k]);
@@ -104,8 +101,8 @@ struct LanceDBTool {
             }
           }
           else if (field.data_type == kLanceDBFieldTypeBlob) {
-            const char* data = ((const char**)field.data)[j];
-            size_t datasize = field.binary_size[j];
+            const char* data = (const char*)field.data + field.offsets[j];
+            size_t datasize = field.offsets[j + 1] - field.offsets[j];
             printf("(length: %5zd) ", datasize);
             for (int k=0; k<datasize; k++) {
               uint8_t d = data[k] & 0xff;
@@ -83,6 +83,104 @@ static_assert(!NativeFieldTypeHelper<BinaryData>::is_memory_continuous, "std::st
 static_assert(!NativeFieldTypeHelper<std::vector<int>>::is_scalar_type, "std::vector<int> is not a scalar type");
 static_assert(NativeFieldTypeHelper<std::vector<int>>::is_memory_continuous, "std::vector<int> is memory continuous");
 
+// Column of one bean field in the layout of lancedb_field_data_t: the values back to back,
+// plus offsets for strings and blobs. It is cleared and refilled for every chunk of beans,
+// so the memory is reused from one chunk to the next. The dimension of a vector column is
+// kept over Clear, it is the one of the first vector checked or appended.
+template <class FieldType>
+class ColumnBuffer {
+  using Helper = NativeFieldTypeHelper<FieldType>;
+  static constexpr bool kIsBytes = LanceDB::IsStringType<FieldType>::value ||
+                                   std::is_same_v<FieldType, BinaryData>;
+  // native type the data type is derived from
+  using ElementType = std::conditional_t<kIsBytes, FieldType, typename Helper::type>;
+  using ValueType = std::conditional_t<kIsBytes, uint8_t, typename Helper::type>;
+
+public:
+  void Clear() {
+    values_.clear();
+    offsets_.clear();
+    count_ = 0;
+  }
+
+  // Returns false if a vector has not the dimension of the first one. Nothing is stored.
+  bool Check(const FieldType& v) {
+    if constexpr (!kIsBytes && !Helper::is_scalar_type) {
+      if (dimension_ == 0) {
+        dimension_ = v.size();
+      }
+      return v.size() == dimension_ && dimension_ != 0;
+    }
+    return true;
+  }
+
+  // Returns false if a vector has not the dimension of the first one.
+  bool Append(const FieldType& v) {
+    if constexpr (kIsBytes) {
+      if (offsets_.empty()) {
+        offsets_.push_back(0);
+      }
+      const uint8_t* begin;
+      size_t size;
+      if constexpr (std::is_same_v<FieldType, std::string>) {
+        begin = reinterpret_cast<const uint8_t*>(v.data());
+        size = v.size();
+      } else if constexpr (std::is_same_v<FieldType, BinaryData>) {
+        begin = v.data.data();
+        size = v.data.size();
+      } else {
+        begin = reinterpret_cast<const uint8_t*>(v);
+        size = v != nullptr ? strlen(v) : 0;
+      }
+      values_.insert(values_.end(), begin, begin + size);
+      offsets_.push_back(values_.size());
+    } else if constexpr (Helper::is_scalar_type) {
+      values_.push_back(v);
+    } else {
+      if (!Check(v)) {
+        return false;
+      }
+      values_.insert(values_.end(), v.begin(), v.end());
+    }
+    count_++;
+    return true;
+  }
+
+  LanceDB::CField GetCField(const char* name) const {
+    LanceDB::Field field;
+    field.name = name;
+    field.data_type = GetDataType();
+    field.field_type = Helper::is_scalar_type ? kLanceDBFieldTypeScalar : kLanceDBFieldTypeVector;
+    field.dimension = Helper::is_scalar_type ? 1 : dimension_;
+    LanceDB::CField cf = LanceDB::GetCField(field);
+    cf.name = name;
+    return cf;
+  }
+
+  LanceDB::CFieldData GetCFieldData(const char* name) const {
+    LanceDB::CFieldData cfd = {};
+    cfd.name = name;
+    cfd.data_type = GetDataType();
+    cfd.field_type = Helper::is_scalar_type ? kLanceDBFieldTypeScalar : kLanceDBFieldTypeVector;
+    cfd.data_count = count_;
+    cfd.dimension = Helper::is_scalar_type ? 1 : dimension_;
+    cfd.data = const_cast<ValueType*>(values_.data());
+    cfd.binary_size = nullptr;
+    cfd.offsets = kIsBytes ? const_cast<size_t*>(offsets_.data()) : nullptr;
+    return cfd;
+  }
+
+private:
+  static LanceDB::DataType GetDataType() {
+    return LanceDB::BaseFieldData<ElementType, LanceDB::List>::template GetDataTypeByNativeType<ElementType>();
+  }
+
+  std::vector<ValueType> values_;
+  std::vector<size_t> offsets_;
+  size_t count_ = 0;
+  size_t dimension_ = 0;
+};
+
 }
 
 template <class AdapterType, template<class> class ContainerTy = std::vector>
@@ -121,20 +219,49 @@ public:
     return *this;
   }
 
+  // Number of beans transposed at a time, 0 to transpose all of them at once. The chunks are
+  // written as a stream while the next one is being transposed, so memory is about one chunk
+  // of columns whatever the number of beans. All the beans are checked before anything is
+  // written, and they are committed together as one table version.
+  TableSchema& SetChunkSize(size_t chunk_size) {
+    chunk_size_ = chunk_size;
+    return *this;
+  }
+
   template <class FloatType>
   LanceDBError Query(const std::string& field_name,
                      const std::vector<FloatType>& embedding, LanceDB::SearchResults& results) {
+    return Query(field_name, embedding, LanceDB::SearchOptions(), results);
+  }
+
+  template <class FloatType>
+  LanceDBError Query(const std::string& field_name, const std::vector<FloatType>& embedding,
+                     const LanceDB::SearchOptions& options, LanceDB::SearchResults& results) {
     if (!IsInited()) {
       return kLanceDBNotConnected;
     }
-    return lancedb_conn_->Query(AdapterType::table_name, field_name, embedding, results);
+    return lancedb_conn_->Query(AdapterType::table_name, field_name, embedding, options, results);
   }
 
   template<class FloatType, class BeanSearchResult>
   LanceDBError Query(const std::string& field_name,
                      const std::vector<FloatType>& embedding, BeanSearchResult& result) {
+    return Query(field_name, embedding, LanceDB::SearchOptions(), result);
+  }
+
+  // Unless `options` selects columns, only the fields mapped by the adapter are read.
+  template<class FloatType, class BeanSearchResult>
+  LanceDBError Query(const std::string& field_name, const std::vector<FloatType>& embedding,
+                     const LanceDB::SearchOptions& options, BeanSearchResult& result) {
     LanceDB::SearchResults sr;
-    auto err = Query("embedding", embedding, sr);
+    LanceDBError err;
+    if (options.select_columns.empty()) {
+      LanceDB::SearchOptions mapped_options = options;
+      mapped_options.select_columns = MappedFieldNames(std::make_index_sequence<AdapterType::N>());
+      err = Query(field_name, embedding, mapped_options, sr);
+    } else {
+      err = Query(field_name, embedding, options, sr);
+    }
     if (err != kLanceDBSuccess) {
       return err;
     }
@@ -151,41 +278,76 @@ public:
   }
 
 private:
-  template<size_t ...I>
-  LanceDBError RunInternal(const BeanList& beans, std::index_sequence<I...>) {
-    std::vector<const char*> field_names = { AdapterType::template FieldName<I>()... };
+  template <size_t I>
+  using FieldTypeAt = std::decay_t<decltype(
+      AdapterType::template FieldValue<I>(std::declval<const BeanType*>()))>;
 
-    using DataTuple = Tuple<ContainerTy<
-        std::decay_t<decltype(std::declval<AdapterType>().template FieldValue<I>(&beans[0]))>> ...>;
-    DataTuple data;
+  template<size_t ...I>
+  struct ChunkProducer {
+    typename BeanList::const_iterator it;
+    typename BeanList::const_iterator end;
+    size_t chunk_size;
+    std::vector<const char*> field_names;
+    Tuple<internal::ColumnBuffer<FieldTypeAt<I>>...> columns;
+    std::vector<LanceDB::CFieldData> cfd;
+
+    // lancedb_batch_producer_t, the columns of a chunk stay valid until the next call
+    static int Produce(void* user_data, lancedb_data_t* batch) {
+      auto* producer = static_cast<ChunkProducer*>(user_data);
+      if (producer->it == producer->end) {
+        return 0;
+      }
+      ( std::get<I>(producer->columns).Clear(), ... );
+      bool valid = true;
+      for (size_t n = 0; n < producer->chunk_size && producer->it != producer->end; n++, ++producer->it) {
+        const BeanType& bean = *producer->it;
+        valid = ( std::get<I>(producer->columns).Append(AdapterType::template FieldValue<I>(&bean)) & ... ) && valid;
+      }
+      if (!valid) {
+        return -1;
+      }
+      producer->cfd = { std::get<I>(producer->columns).GetCFieldData(producer->field_names[I])... };
+      batch->fields = producer->cfd.data();
+      batch->num_fields = producer->cfd.size();
+      return 1;
+    }
+  };
 
-    LanceDBError ret = kLanceDBSuccess;
+  template<size_t ...I>
+  LanceDBError RunInternal(const BeanList& beans, std::index_sequence<I...>) {
+    if (beans.empty()) {
+      return kLanceDBInvalidData;
+    }
+    ChunkProducer<I...> producer;
+    producer.it = beans.begin();
+    producer.end = beans.end();
+    producer.chunk_size = chunk_size_ > 0 ? chunk_size_ : beans.size();
+    producer.field_names = { AdapterType::template FieldName<I>()... };
+
+    // every bean is checked first, so that a bad one does not fail the write half way
+    bool valid = true;
     for (const BeanType& bean: beans) {
-      ( std::get<I>(data).emplace_back(AdapterType::template FieldValue<I>(&bean)), ... );
+      valid = ( std::get<I>(producer.columns).Check(AdapterType::template FieldValue<I>(&bean)) & ... ) && valid;
+    }
+    if (!valid) {
+      return kLanceDBInvalidData;
     }
 
-    std::string demangle_tmp;
-#if LANCEDB_DEBUG_DEMANGLE_TYPE
-    ( printf("field: %s    size: %zd     type: %s\n",
-             field_names[I], std::get<I>(data).size(),
-             (demangle_tmp = DemangleSymbol(typeid(std::decay_t<decltype(
-                 std::declval<AdapterType>().template FieldValue<I>(&beans[0]))>))).c_str()), ... );
-#endif
-    auto data_tuple = std::make_tuple(LanceDB::FieldData(field_names[I], std::get<I>(data))...);
-    auto create_inserter = [&](auto&&... args) {
-      return lancedb_conn_->CreateBatchInserter(std::forward<decltype(args)>(args)...);
-    };
-    auto inserter = std::apply(create_inserter, data_tuple);
+    lancedb_handle_t hnd = lancedb_conn_->GetHandle();
     if (create_table_) {
-      ret = inserter.CreateTable(AdapterType::table_name);
-      if (ret != kLanceDBSuccess) {
-        return ret;
+      std::vector<LanceDB::CField> fields = { std::get<I>(producer.columns).GetCField(producer.field_names[I])... };
+      lancedb_schema_t schema;
+      schema.fields = fields.data();
+      schema.num_fields = fields.size();
+      if (!lancedb_create_table_with_schema(hnd, AdapterType::table_name, &schema)) {
+        return kLanceDBInternalError;
       }
     }
-    if (create_data_) {
-      ret = inserter.Insert(AdapterType::table_name);
+    if (!create_data_) {
+      return kLanceDBSuccess;
     }
-    return ret;
+    bool result = lancedb_insert_stream(hnd, AdapterType::table_name, &ChunkProducer<I...>::Produce, &producer);
+    return result ? kLanceDBSuccess : kLanceDBInsertFailed;
   }
 
   LanceDBError FillDistanceField(std::vector<float>& distance, const LanceDB::SearchResults& results) {
@@ -242,39 +404,47 @@ private:
 //    else {
 //      LANCEDB_LOGD("bean list is not empty, data size = %ld, bean size = %ld", data_field->data_count, beans.size());
 //    }
-    FieldNativeType* data_ptr = (FieldNativeType*)data_field->data;
-    for (int i=0; i<data_field->data_count; i++) {
-      if constexpr (internal::NativeFieldTypeHelper<FieldType>::is_scalar_type) {
-        // Is scalar type
-        // LANCEDB_LOGD("Is scalar type");
-        AdapterType::template FieldValue<I>(&beans[i]) = data_ptr[i];
-      } else if constexpr (internal::NativeFieldTypeHelper<FieldType>::is_memory_continuous) {
-        // Is vector type, but memory continuous
-        // LANCEDB_LOGD("Is vector type, but memory continuous, dimension: %d", data_field->dimension);
-        auto& vec = AdapterType::template FieldValue<I>(&beans[i]);
-        vec.resize(data_field->dimension);
-        void* dst = vec.data();
-        void* src = data_ptr + (i * data_field->dimension);
-        size_t copy_sz = data_field->dimension * sizeof(FieldNativeType);
-        // LANCEDB_LOGD("    Copy size: %zd", copy_sz);
-        memcpy(dst, src, copy_sz);
-      } else {
-        // Is neither scalar type nor memory continuous
-        // LANCEDB_LOGD("Is neither scalar type nor memory continuous");
-        if constexpr (std::is_same_v<BinaryData, FieldType>) {
-          BinaryData& bin = AdapterType::template FieldValue<I>(&beans[i]);
-          if (data_field->binary_size) {
-            LANCEDB_LOGD("warning: binary_size == nullptr, ignore this field");
-            return kLanceDBInvalidData;
-          }
-          size_t bin_size = data_field->binary_size[i];
-          // LANCEDB_LOGD("   binary size: %zd", bin_size);
-          bin.data.resize(bin_size);
-          void* dst = bin.data.data();
-          void* src = data_ptr[i];
-          memcpy(dst, src, bin_size);
+    if constexpr (std::is_same_v<FieldType, std::string> || std::is_same_v<FieldType, BinaryData>) {
+      // strings and blobs come in the contiguous layout
+      if (data_field->offsets == nullptr) {
+        LANCEDB_LOGD("warning: offsets == nullptr, ignore this field");
+        return kLanceDBInvalidData;
+      }
+      const uint8_t* values = (const uint8_t*)data_field->data;
+      for (size_t i=0; i<data_field->data_count; i++) {
+        const uint8_t* begin = values + data_field->offsets[i];
+        const uint8_t* end = values + data_field->offsets[i + 1];
+        auto& value = AdapterType::template FieldValue<I>(&beans[i]);
+        if constexpr (std::is_same_v<FieldType, std::string>) {
+          value.assign((const char*)begin, end - begin);
+        } else {
+          value.data.assign(begin, end);
         }
-        else {
+      }
+      return kLanceDBSuccess;
+    } else if constexpr (std::is_same_v<FieldType, const char*> || std::is_same_v<FieldType, char*>) {
+      LANCEDB_LOGD("warning: C string fields cannot hold results, use std::string instead");
+      return kLanceDBUnsupportedDataType;
+    } else {
+      FieldNativeType* data_ptr = (FieldNativeType*)data_field->data;
+      for (size_t i=0; i<data_field->data_count; i++) {
+        if constexpr (internal::NativeFieldTypeHelper<FieldType>::is_scalar_type) {
+          // Is scalar type
+          // LANCEDB_LOGD("Is scalar type");
+          AdapterType::template FieldValue<I>(&beans[i]) = data_ptr[i];
+        } else if constexpr (internal::NativeFieldTypeHelper<FieldType>::is_memory_continuous) {
+          // Is vector type, but memory continuous
+          // LANCEDB_LOGD("Is vector type, but memory continuous, dimension: %d", data_field->dimension);
+          auto& vec = AdapterType::template FieldValue<I>(&beans[i]);
+          vec.resize(data_field->dimension);
+          void* dst = vec.data();
+          void* src = data_ptr + (i * data_field->dimension);
+          size_t copy_sz = data_field->dimension * sizeof(FieldNativeType);
+          // LANCEDB_LOGD("    Copy size: %zd", copy_sz);
+          memcpy(dst, src, copy_sz);
+        } else {
+          // Is neither scalar type nor memory continuous
+          // LANCEDB_LOGD("Is neither scalar type nor memory continuous");
           static_assert(std::is_same_v<FieldType, void>, "invalid field type, field type is unsupported");
         }
       }
@@ -283,6 +453,11 @@ private:
     return kLanceDBSuccess;
   }
 
+  template<size_t ...I>
+  static std::vector<std::string> MappedFieldNames(std::index_sequence<I...>) {
+    return { AdapterType::template FieldName<I>()... };
+  }
+
   template<size_t ...I>
   LanceDBError QueryInternal(BeanList& beans, LanceDB::SearchResults& results, std::index_sequence<I...>) {
     std::vector<const char*> field_names = { AdapterType::template FieldName<I>()... };
@@ -292,10 +467,12 @@ private:
   }
 
   constexpr static const int kNumFields = AdapterType::N;
+  constexpr static const size_t kDefaultChunkSize = 65536;
 
   LanceDB* lancedb_conn_;
   bool create_table_ = false;
   bool create_data_ = true;
+  size_t chunk_size_ = kDefaultChunkSize;
 };
 
 }
@@ -1,4 +1,5 @@
 #include <cstdio>
+#include <string>
 #include <cstdlib>
 #include <ctime>
 #include <vector>
@@ -180,7 +181,9 @@ int test_insert_data() {
       kLanceDBFieldTypeScalar,
       30,
       1,
-      seq_data
+      seq_data,
+      nullptr,
+      nullptr
   };
 
   lancedb_field_data_t name_field = {
@@ -189,7 +192,9 @@ int test_insert_data() {
       kLanceDBFieldTypeScalar,
       30,
       1,
-      seq_data
+      seq_data,
+      nullptr,
+      nullptr
   };
 
 
@@ -216,7 +221,9 @@ int test_insert_data() {
       kLanceDBFieldTypeVector,
       30,
       512,
-      vectors
+      vectors,
+      nullptr,
+      nullptr
   };
 
   lancedb_field_data_t time_field = {
@@ -225,12 +232,17 @@ int test_insert_data() {
       kLanceDBFieldTypeScalar,
       30,
       1,
-      tm_data
+      tm_data,
+      nullptr,
+      nullptr
   };
 
-  const char *comment_data[30];
+  // strings in the contiguous layout: all the values in one buffer, plus 31 offsets
+  std::string comment_data;
+  size_t comment_offsets[31] = { 0 };
   for (int i = 0; i < 30; i++) {
-    comment_data[i] = "Hello world";
+    comment_data += "Hello world";
+    comment_offsets[i + 1] = comment_data.size();
   }
   lancedb_field_data_t comment_field = {
       nullptr,
@@ -238,7 +250,9 @@ int test_insert_data() {
       kLanceDBFieldTypeScalar,
       30,
       1,
-      comment_data
+      (void*)comment_data.data(),
+      nullptr,
+      comment_offsets
   };
 
   const char *blob_test = "\012\0Hello\0World\0H1234";
@@ -256,7 +270,8 @@ int test_insert_data() {
       30,
       1,
       blob_data,
-      blob_data_sz
+      blob_data_sz,
+      nullptr
   };
 
   // Create an array of fields
@@ -333,13 +348,9 @@ void PrintFieldData(lancedb_field_data_t &field, int i, int j) {
     double* data = (double*)field.data;
     printf("%f\t", data[i * field.dimension + j]);
   }
-  else if (field.data_type == kLanceDBFieldTypeString) {
-    const char** data = (const char**)field.data;
-    printf("%s\t", data[i * field.dimension]);
-  }
-  else if (field.data_type == kLanceDBFieldTypeBlob) {
-    const char** data = (const char**)field.data;
-    printf("%s\t", data[i * field.dimension]);
+  else if (field.data_type == kLanceDBFieldTypeString || field.data_type == kLanceDBFieldTypeBlob) {
+    const char* data = (const char*)field.data;
+    printf("%.*s\t", (int)(field.offsets[i + 1] - field.offsets[i]), data + field.offsets[i]);
   }
   else if (field.data_type == kLanceDBFieldTypeTimestamp) {
     int64_t* data = (int64_t*)field.data;
@@ -379,7 +390,7 @@ void test_search_from_created() {
       LANCEDB_LOGD("   data_count: %zd", result_data.fields[i].data_count);
       LANCEDB_LOGD("   dimension:  %zd", result_data.fields[i].dimension);
       LANCEDB_LOGD("   data:       %p", result_data.fields[i].data);
-      LANCEDB_LOGD("   binary_size: %p", result_data.fields[i].binary_size);
+      LANCEDB_LOGD("   offsets:    %p", result_data.fields[i].offsets);
       LANCEDB_LOGD("   field_type: %d", result_data.fields[i].field_type);
 
       if (field.data == nullptr) {
@@ -392,8 +403,8 @@ void test_search_from_created() {
         for (int j=0; j<field.data_count; j++) {
           printf("[%3d] ", j);
           if (field.data_type == kLanceDBFieldTypeString) {
-            const char* data = ((const char**)field.data)[j];
-            size_t datasize = field.binary_size[j];
+            const char* data = (const char*)field.data + field.offsets[j];
+            size_t datasize = field.offsets[j + 1] - field.offsets[j];
             printf("(length: %5zd) ", datasize);
             for (int k=0; k<datasize; k++) {
               printf("%c", data[k]);
@@ -404,8 +415,8 @@ void test_search_from_created() {
             }
           }
           else if (field.data_type == kLanceDBFieldTypeBlob) {
-            const char* data = ((const char**)field.data)[j];
-            size_t datasize = field.binary_size[j];
+            const char* data = (const char*)field.data + field.offsets[j];
+            size_t datasize = field.offsets[j + 1] - field.offsets[j];
             printf("(length: %5zd) ", datasize);
             for (int k=0; k<datasize; k++) {
               uint8_t d = data[k] & 0xff;
@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+
+#include "lancedb.hpp"
+#include "lancedb_tools.hpp"
+
+#if LANCEDB_HAS_COROUTINE
+
+#define ASSERT_EQ(a, b) if ((a) != (b)) { fprintf(stderr, "assert failed: %s != %s\n", #a, #b); exit(1); }
+
+using namespace lancedb;
+
+static std::vector<float> RandomEmbedding(int dim) {
+  std::vector<float> embedding(dim);
+  float norm = 0;
+  for (int j=0; j<dim; j++) {
+    embedding[j] = (rand() % 1000) / 1000.0f;
+    norm += embedding[j] * embedding[j];
+  }
+  norm = std::sqrt(norm);
+  for (int j=0; j<dim; j++) {
+    embedding[j] /= norm;
+  }
+  return embedding;
+}
+
+// Inserts a batch, then issues several searches at once and awaits them together.
+static Task<LanceDBError> Run(LanceDB& db, LanceDB::Table& table,
+                              const std::vector<std::vector<float>>& embeddings, Executor* executor) {
+  std::vector<int> idx;
+  for (int i=0; i<(int)embeddings.size(); i++) {
+    idx.push_back(i);
+  }
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+  auto err = co_await inserter.InsertAsync(table, executor);
+  if (err != kLanceDBSuccess) {
+    co_return err;
+  }
+
+  const int num_queries = 4;
+  std::vector<LanceDB::SearchResults> results(num_queries);
+  std::vector<Task<LanceDBError>> tasks;
+  for (int i=0; i<num_queries; i++) {
+    tasks.push_back(db.QueryAsync(table, "embedding", embeddings[i], results[i], executor));
+  }
+  for (int i=0; i<num_queries; i++) {
+    err = co_await tasks[i];
+    if (err != kLanceDBSuccess) {
+      co_return err;
+    }
+    printf("results of query %d:\n", i);
+    LanceDBTool::PrintResult(results[i].Get());
+  }
+  co_return kLanceDBSuccess;
+}
+
+int main() {
+  system("rm -rf test_coroutine.db");
+  LanceDB db("test_coroutine.db");
+
+  std::vector<std::vector<float>> embeddings;
+  for (int i=0; i<100; i++) {
+    embeddings.push_back(RandomEmbedding(768));
+  }
+
+  // create the table with the first row, the rest is inserted from the coroutine
+  std::vector<int> first_idx = { -1 };
+  std::vector<std::vector<float>> first_embedding = { embeddings[0] };
+  LanceDB::FieldData idx_data("idx", first_idx);
+  LanceDB::FieldData embedding_data("embedding", first_embedding);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+  auto err = inserter.CreateTable("test_table");
+  ASSERT_EQ(err, kLanceDBSuccess);
+
+  LanceDB::Table table;
+  err = db.OpenTable("test_table", table);
+  ASSERT_EQ(err, kLanceDBSuccess);
+
+  // resume the coroutines on our own thread instead of the runtime worker threads
+  ThreadPoolExecutor executor(1);
+  err = SyncWait(Run(db, table, embeddings, &executor));
+  ASSERT_EQ(err, kLanceDBSuccess);
+}
+
+#else
+
+int main() {
+  fprintf(stderr, "sample_lancedb_coroutine requires a C++20 compiler with coroutine support\n");
+  return 1;
+}
+
+#endif // LANCEDB_HAS_COROUTINE
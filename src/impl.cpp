@@ -11,8 +11,10 @@ bool lancedb_free_search_results(lancedb_data_t* search_results) {
   for (size_t i = 0; i < search_results->num_fields; i++) {
     lancedb_field_data_t* field_data = &search_results->fields[i];
 
-    if (field_data->data_type == kLanceDBFieldTypeString ||
-        field_data->data_type == kLanceDBFieldTypeBlob) {
+    // string and blob values in the per-row pointer layout are allocated one by one
+    if ((field_data->data_type == kLanceDBFieldTypeString ||
+         field_data->data_type == kLanceDBFieldTypeBlob) &&
+        field_data->offsets == nullptr && field_data->data != nullptr) {
       char** data = (char**)field_data->data;
       for (int j = 0; j < field_data->data_count; j++) {
         free(data[j]);
@@ -27,6 +29,10 @@ bool lancedb_free_search_results(lancedb_data_t* search_results) {
       free(field_data->binary_size);
       field_data->binary_size = nullptr;
     }
+    if (field_data->offsets != nullptr) {
+      free(field_data->offsets);
+      field_data->offsets = nullptr;
+    }
     if (field_data->name != nullptr) {
       free((char*)field_data->name);
     }
@@ -3,45 +3,85 @@ extern crate lazy_static;
 
 pub use lancedb;
 use lancedb::{Connection};
-use tokio::runtime::Runtime;
-use arrow_array::{Array, ArrayRef, ArrowPrimitiveType, BinaryArray, FixedSizeListArray, Float16Array, Float32Array, Float64Array, Int16Array, Int32Array, Int64Array, Int8Array, RecordBatch, RecordBatchIterator, StringArray, TimestampMillisecondArray, UInt16Array, UInt32Array, UInt64Array, UInt8Array};
-use arrow_schema::{DataType, Field, Schema, TimeUnit};
+use lance::dataset::ReadParams;
+use lance::dataset::optimize::CompactionOptions;
+use lance_index::optimize::OptimizeOptions;
+use lancedb::table::{AddDataMode, OptimizeAction, WriteOptions};
+use lancedb::connection::CreateTableMode;
+use lance::dataset::{WriteMode, WriteParams};
+use tokio::runtime::{Builder, Runtime};
+use arrow_array::{Array, ArrayRef, ArrowPrimitiveType, BinaryArray, FixedSizeListArray, Float16Array, Float32Array, Float64Array, Int16Array, Int32Array, Int64Array, Int8Array, PrimitiveArray, RecordBatch, RecordBatchReader, RecordBatchIterator, StringArray, TimestampMillisecondArray, UInt16Array, UInt32Array, UInt64Array, UInt8Array};
+use arrow_array::ffi::{from_ffi, FFI_ArrowArray, FFI_ArrowSchema};
+use arrow_array::ffi_stream::{ArrowArrayStreamReader, FFI_ArrowArrayStream};
+use arrow_array::make_array;
+use arrow_array::types::ByteArrayType;
+use arrow_array::GenericByteArray;
+use arrow_buffer::{Buffer, OffsetBuffer, ScalarBuffer};
+use arrow_select::concat::concat_batches;
+use arrow_schema::{ArrowError, DataType, Field, Schema, SchemaRef, TimeUnit};
 
 use std::collections::HashMap;
-use std::sync::Mutex;
+use std::sync::{Arc, RwLock};
 use std::os::raw::c_void;
 use std::os::raw::c_char;
-use std::marker::PhantomData;
-use std::hash::{Hash, Hasher};
 
 use std::ffi::{CStr, CString};
 use arrow_array::cast::AsArray;
-use arrow_array::types::{Float16Type, Float32Type, Float64Type, Int16Type, Int32Type, Int64Type, Int8Type, TimestampMillisecondType, UInt16Type, UInt32Type, UInt64Type, UInt8Type};
+use arrow_array::types::{BinaryType, Utf8Type, Float16Type, Float32Type, Float64Type, Int16Type, Int32Type, Int64Type, Int8Type, TimestampMillisecondType, UInt16Type, UInt32Type, UInt64Type, UInt8Type};
 use arrow_schema::DataType::FixedSizeList;
-use lancedb::query::ExecutableQuery;
+use lancedb::query::{ExecutableQuery, QueryBase, Select};
 use std::mem;
 use std::ptr::{null_mut};
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, Ordering};
+use tokio::sync::{mpsc, oneshot, Notify};
+use std::time::{Duration, Instant};
+
+lazy_static! {
+    /// Registry of the open connections, keyed by the handle value given out to C. It is
+    /// only locked to look a handle up (shared) or to add/remove one (exclusive); calls
+    /// clone the `Arc` out and run without holding the lock, so requests on the same or
+    /// different connections run in parallel.
+    static ref CONNECTIONS: RwLock<HashMap<usize, Arc<LanceDBConnection>>> = RwLock::new(HashMap::new());
+}
 
-struct SendPtr(*mut c_void, PhantomData<Vec<u8>>);
+/// Object behind a `lancedb_handle_t`. The runtime is created once in `lancedb_init` and
+/// reused by every call on the handle, so a request does not pay for spinning up and
+/// tearing down a worker pool.
+struct LanceDBConnection {
+    connection: Connection,
+    runtime: Option<Runtime>,
+    /// Cache sizes applied to every table opened on this connection, 0 for the default.
+    index_cache_size: usize,
+    metadata_cache_size: usize,
+}
 
-impl PartialEq for SendPtr {
-    fn eq(&self, other: &Self) -> bool {
-        self.0 == other.0
+impl LanceDBConnection {
+    fn runtime(&self) -> &Runtime {
+        self.runtime.as_ref().unwrap()
     }
 }
 
-impl Eq for SendPtr {}
-
-impl Hash for SendPtr {
-    fn hash<H: Hasher>(&self, state: &mut H) {
-        self.0.hash(state);
+impl Drop for LanceDBConnection {
+    fn drop(&mut self) {
+        // The last reference may be released on a runtime worker thread (e.g. by a pending
+        // task), where a blocking shutdown is not allowed.
+        if let Some(runtime) = self.runtime.take() {
+            runtime.shutdown_background();
+        }
     }
 }
 
+/// Pointer owned by the C caller that is carried into a task on the runtime: either caller
+/// memory that stays valid until the task completes, or user data given back to a callback.
+#[derive(Clone, Copy)]
+struct SendPtr(*mut c_void);
+
 unsafe impl Send for SendPtr {}
 
-lazy_static! {
-    static ref CONNECTIONS: Mutex<HashMap<SendPtr, SendPtr>> = Mutex::new(HashMap::new());
+/// Looks up a connection handle, returns None if it is not open.
+fn get_connection(connection_ptr: *mut c_void) -> Option<Arc<LanceDBConnection>> {
+    CONNECTIONS.read().unwrap().get(&(connection_ptr as usize)).cloned()
 }
 
 pub async fn lancedb_init_async(uri: &str) -> Connection {
@@ -113,6 +153,7 @@ pub struct lancedb_field_data_t {
     dimension: usize, // only for vector
     data: *mut c_void, // for vector, it is a pointer to a 2D array; for scalar, it is a pointer to a 1D array
     binary_size: * mut usize, // only for blob types
+    offsets: *mut usize, // only for string and blob types, contiguous layout
 }
 
 #[repr(C)]
@@ -121,42 +162,243 @@ pub struct lancedb_data_t {
     num_fields: usize,
 }
 
+#[repr(C)]
+pub struct lancedb_options_t {
+    worker_threads: usize,
+    max_blocking_threads: usize,
+    cpu_affinity: *const i32,
+    num_cpu_affinity: usize,
+    index_cache_size: usize,
+    metadata_cache_size: usize,
+}
+
+#[repr(C)]
+pub struct lancedb_appender_options_t {
+    max_rows: usize,
+    max_bytes: usize,
+    max_interval_ms: u64,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum lancedb_write_mode_t {
+    LanceDBWriteModeAppend,
+    LanceDBWriteModeOverwrite,
+}
+
+#[repr(C)]
+pub struct lancedb_write_options_t {
+    max_rows_per_file: usize,
+    max_rows_per_group: usize,
+    max_bytes_per_file: usize,
+    mode: lancedb_write_mode_t,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum lancedb_distance_type_t {
+    LanceDBDistanceCosine,
+    LanceDBDistanceL2,
+    LanceDBDistanceDot,
+}
+
+impl lancedb_distance_type_t {
+    fn to_distance_type(self) -> lancedb::DistanceType {
+        match self {
+            lancedb_distance_type_t::LanceDBDistanceCosine => lancedb::DistanceType::Cosine,
+            lancedb_distance_type_t::LanceDBDistanceL2 => lancedb::DistanceType::L2,
+            lancedb_distance_type_t::LanceDBDistanceDot => lancedb::DistanceType::Dot,
+        }
+    }
+}
+
+#[repr(C)]
+pub struct lancedb_search_options_t {
+    limit: usize,
+    nprobes: usize,
+    refine_factor: u32,
+    distance_type: lancedb_distance_type_t,
+    select_columns: *const *const c_char,
+    num_select_columns: usize,
+    filter: *const c_char,
+    postfilter: i32,
+}
+
+#[repr(C)]
+pub struct lancedb_index_options_t {
+    distance_type: lancedb_distance_type_t,
+    num_partitions: u32,
+    num_sub_vectors: u32,
+}
+
+#[repr(C)]
+pub struct lancedb_optimize_options_t {
+    compact: i32,
+    target_rows_per_fragment: usize,
+    prune: i32,
+    prune_older_than_secs: u64,
+    optimize_indices: i32,
+}
+
+#[repr(C)]
+#[derive(Default)]
+pub struct lancedb_optimize_stats_t {
+    fragments_removed: u64,
+    fragments_added: u64,
+    files_removed: u64,
+    files_added: u64,
+    versions_removed: u64,
+    bytes_removed: u64,
+    elapsed_ms: u64,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum lancedb_upsert_mode_t {
+    LanceDBUpsertUpdateOrInsert,
+    LanceDBUpsertUpdateOnly,
+    LanceDBUpsertInsertOnly,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum lancedb_durability_t {
+    LanceDBDurabilityEnqueued,
+    LanceDBDurabilityCommitted,
+}
+
+#[repr(C)]
+pub struct lancedb_write_buffer_options_t {
+    flush_interval_ms: u64,
+    max_rows: usize,
+    durability: lancedb_durability_t,
+}
+
+#[repr(C)]
+#[derive(Default, Clone, Copy)]
+pub struct lancedb_write_buffer_stats_t {
+    num_writes: u64,
+    num_commits: u64,
+    num_failed_commits: u64,
+    num_committed_rows: u64,
+    min_commit_rows: u64,
+    max_commit_rows: u64,
+    last_commit_rows: u64,
+    pending_rows: u64,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub enum lancedb_vector_format_t {
+    LanceDBVectorFormatFvecs,
+    LanceDBVectorFormatNpy,
+    LanceDBVectorFormatRaw,
+}
+
+#[repr(C)]
+pub struct lancedb_import_options_t {
+    vector_column: *const c_char,
+    id_column: *const c_char,
+    first_id: i64,
+    dimension: usize,
+    header_size: usize,
+    chunk_rows: usize,
+    create_table: i32,
+}
+
 ////////////// END OF C TYPES //////////////
 
+/// Pins the calling thread to the given CPUs.
+#[cfg(any(target_os = "linux", target_os = "android"))]
+fn set_thread_affinity(cpus: &[usize]) {
+    unsafe {
+        let mut set: libc::cpu_set_t = mem::zeroed();
+        libc::CPU_ZERO(&mut set);
+        for &cpu in cpus {
+            libc::CPU_SET(cpu, &mut set);
+        }
+        if libc::sched_setaffinity(0, mem::size_of::<libc::cpu_set_t>(), &set) != 0 {
+            eprintln!("Failed to set thread affinity: {}", std::io::Error::last_os_error());
+        }
+    }
+}
+
+#[cfg(not(any(target_os = "linux", target_os = "android")))]
+fn set_thread_affinity(_cpus: &[usize]) {
+    eprintln!("Thread affinity is not supported on this platform");
+}
+
+/// Builds the runtime of a connection, tokio defaults are used for the options left at 0.
+fn build_runtime(options: &lancedb_options_t) -> std::io::Result<Runtime> {
+    let mut builder = Builder::new_multi_thread();
+    builder.enable_all();
+    if options.worker_threads != 0 {
+        builder.worker_threads(options.worker_threads);
+    }
+    if options.max_blocking_threads != 0 {
+        builder.max_blocking_threads(options.max_blocking_threads);
+    }
+    if !options.cpu_affinity.is_null() && options.num_cpu_affinity != 0 {
+        let cpus: Vec<usize> = unsafe {
+            std::slice::from_raw_parts(options.cpu_affinity, options.num_cpu_affinity)
+        }.iter().filter(|&&cpu| cpu >= 0).map(|&cpu| cpu as usize).collect();
+        builder.on_thread_start(move || set_thread_affinity(&cpus));
+    }
+    builder.build()
+}
+
 #[no_mangle]
 pub extern "C" fn lancedb_init(uri: *const c_char) -> *mut c_void {
+    lancedb_init_with_options(uri, std::ptr::null())
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_init_with_options(
+    uri: *const c_char,
+    options: *const lancedb_options_t,
+) -> *mut c_void {
     let uri = unsafe {
         assert!(!uri.is_null());
         CStr::from_ptr(uri).to_str().unwrap()
     };
+    let default_options = lancedb_options_t {
+        worker_threads: 0,
+        max_blocking_threads: 0,
+        cpu_affinity: std::ptr::null(),
+        num_cpu_affinity: 0,
+        index_cache_size: 0,
+        metadata_cache_size: 0,
+    };
+    let options = if options.is_null() { &default_options } else { unsafe { &*options } };
 
-    let rt = Runtime::new().unwrap();
-    let connection = rt.block_on(lancedb_init_async(uri));
+    let runtime = match build_runtime(options) {
+        Ok(runtime) => runtime,
+        Err(e) => {
+            eprintln!("Failed to create runtime: {}", e);
+            return null_mut();
+        }
+    };
+    let connection = runtime.block_on(lancedb_init_async(uri));
 
-    let connection_box = Box::new(connection);
-    let connection_ptr = Box::into_raw(connection_box) as *mut c_void;
+    let handle = Arc::new(LanceDBConnection {
+        connection,
+        runtime: Some(runtime),
+        index_cache_size: options.index_cache_size,
+        metadata_cache_size: options.metadata_cache_size,
+    });
+    let connection_ptr = Arc::as_ptr(&handle) as *mut c_void;
 
-    CONNECTIONS.lock().unwrap().insert(SendPtr(connection_ptr, PhantomData),
-                                       SendPtr(connection_ptr, PhantomData));
+    CONNECTIONS.write().unwrap().insert(connection_ptr as usize, handle);
 
     connection_ptr
 }
 
 #[no_mangle]
 pub extern "C" fn lancedb_close(connection_ptr: *mut c_void) -> bool {
-    let mut connections = CONNECTIONS.lock().unwrap();
-    let send_ptr = SendPtr(connection_ptr, PhantomData);
-    if let Some(_connection) = connections.remove(&send_ptr) {
-        // Deallocate the memory for the Connection instance
-        unsafe {
-            let _ = Box::from_raw(connection_ptr as *mut Connection);
-        }
-        // println!("connection closed");
-        true
-    } else {
-        // println!("connection close failed");
-        false
-    }
+    let connection = CONNECTIONS.write().unwrap().remove(&(connection_ptr as usize));
+    // Calls still running on this connection hold their own reference, the connection
+    // and its runtime are released when the last of them returns.
+    connection.is_some()
 }
 
 #[no_mangle]
@@ -168,7 +410,6 @@ pub extern "C" fn lancedb_create_table(
     count: i32,
 ) -> bool {
 
-    use std::sync::Arc;
     use std::slice;
 
     // Convert C types to Rust types
@@ -216,14 +457,18 @@ pub extern "C" fn lancedb_create_table(
         schema.clone(),
     );
 
-    // Get the connection from the HashMap
-    let connections = CONNECTIONS.lock().unwrap();
-    let send_ptr = SendPtr(connection_ptr, PhantomData);
-    let send_ptr = connections.get(&send_ptr).unwrap();
-    let connection = unsafe { &mut *(send_ptr.0 as *mut Connection) };
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let connection = &handle.connection;
+    let rt = handle.runtime();
 
     // Create the table
-    let rt = Runtime::new().unwrap();
     let result = rt.block_on(async {
         connection
             .create_table(table_name, Box::new(batches))
@@ -253,21 +498,10 @@ pub extern "C" fn lancedb_create_table(
     return true;
 }
 
-#[no_mangle]
-pub extern "C" fn lancedb_create_table_with_schema(
-    connection_ptr: *mut c_void,
-    table_name: *const c_char,
-    schema: *mut lancedb_schema_t,
-) -> bool {
-    use std::sync::Arc;
+/// Converts the C table schema to an arrow schema.
+fn c_schema_to_schema(schema: *mut lancedb_schema_t) -> SchemaRef {
     use std::slice;
 
-    // Convert C types to Rust types
-    let table_name = unsafe {
-        assert!(!table_name.is_null());
-        CStr::from_ptr(table_name).to_str().unwrap()
-    };
-
     let schema = unsafe {
         assert!(!schema.is_null());
         &*schema
@@ -317,18 +551,37 @@ pub extern "C" fn lancedb_create_table_with_schema(
         }
     }
 
+    Arc::new(Schema::new(rust_fields))
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_create_table_with_schema(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    schema: *mut lancedb_schema_t,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+
     // Create the table schema
-    let schema = Arc::new(Schema::new(rust_fields));
+    let schema = c_schema_to_schema(schema);
     // println!("schema: {:?}", schema);
 
-    // Get the connection from the HashMap
-    let connections = CONNECTIONS.lock().unwrap();
-    let send_ptr = SendPtr(connection_ptr, PhantomData);
-    let send_ptr = connections.get(&send_ptr).unwrap();
-    let connection = unsafe { &mut *(send_ptr.0 as *mut Connection) };
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let connection = &handle.connection;
+    let rt = handle.runtime();
 
     // Create the table
-    let rt = Runtime::new().unwrap();
     let result = rt.block_on(async {
         connection
             .create_table(table_name, Box::new(RecordBatchIterator::new(vec![].into_iter().map(Ok), schema.clone())))
@@ -345,53 +598,159 @@ pub extern "C" fn lancedb_create_table_with_schema(
     }
 }
 
+/// Lance write parameters from the C write options, fields left 0 keep the lance default.
+fn c_write_params(options: *const lancedb_write_options_t, create: bool) -> WriteParams {
+    let mut params = WriteParams::default();
+    let options = match unsafe { options.as_ref() } {
+        Some(options) => options,
+        None => return params,
+    };
+    if options.max_rows_per_file != 0 {
+        params.max_rows_per_file = options.max_rows_per_file;
+    }
+    if options.max_rows_per_group != 0 {
+        params.max_rows_per_group = options.max_rows_per_group;
+    }
+    if options.max_bytes_per_file != 0 {
+        params.max_bytes_per_file = options.max_bytes_per_file;
+    }
+    params.mode = match (options.mode, create) {
+        (lancedb_write_mode_t::LanceDBWriteModeOverwrite, _) => WriteMode::Overwrite,
+        (lancedb_write_mode_t::LanceDBWriteModeAppend, true) => WriteMode::Create,
+        (lancedb_write_mode_t::LanceDBWriteModeAppend, false) => WriteMode::Append,
+    };
+    params
+}
+
 #[no_mangle]
-pub extern "C" fn lancedb_insert(
+pub extern "C" fn lancedb_create_table_with_data(
     connection_ptr: *mut c_void,
     table_name: *const c_char,
+    schema: *mut lancedb_schema_t,
     field_data: *mut lancedb_data_t,
+    options: *const lancedb_write_options_t,
 ) -> bool {
-    use std::sync::Arc;
-    use std::slice;
-
     // Convert C types to Rust types
     let table_name = unsafe {
         assert!(!table_name.is_null());
         CStr::from_ptr(table_name).to_str().unwrap()
     };
 
-    let field_data = unsafe {
-        assert!(!field_data.is_null());
-        &*field_data
+    // Create the table schema and the first batch
+    let schema = c_schema_to_schema(schema);
+    let mut batches = Vec::new();
+    if !field_data.is_null() {
+        let arrays = c_data_to_arrays(field_data);
+        match c_arrays_to_batch(schema.clone(), arrays) {
+            Ok(batch) => batches.push(batch),
+            Err(e) => {
+                eprintln!("Failed to create record batch: {}", e);
+                return false;
+            }
+        }
+    }
+    let params = c_write_params(options, true);
+    let mode = match params.mode {
+        WriteMode::Overwrite => CreateTableMode::Overwrite,
+        _ => CreateTableMode::Create,
     };
 
-    // Convert the field_data to a Rust vector of Fields
-    let data = unsafe {
-        slice::from_raw_parts(field_data.fields as *const lancedb_field_data_t, field_data.num_fields)
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
     };
 
-    // Get the connection from the HashMap
-    let connections = CONNECTIONS.lock().unwrap();
-    let send_ptr = SendPtr(connection_ptr, PhantomData);
-    let send_ptr = connections.get(&send_ptr).unwrap();
-    let connection = unsafe { &mut *(send_ptr.0 as *mut Connection) };
+    // The table and its first rows are written in a single commit
+    let batches = RecordBatchIterator::new(batches.into_iter().map(Ok), schema);
+    let result = handle.runtime().block_on(
+        handle.connection
+            .create_table(table_name, Box::new(batches))
+            .mode(mode)
+            .write_options(WriteOptions { lance_write_params: Some(params) })
+            .execute()
+    );
 
-    // Insert the data into the table
-    let rt = Runtime::new().unwrap();
-    let table = rt.block_on(async {
-        let table = connection.open_table(table_name).execute().await;
-        return table;
-    });
+    match result {
+        Ok(_) => true,
+        Err(e) => {
+            eprintln!("Failed to create table: {}", e);
+            false
+        }
+    }
+}
 
-    let table = match table {
-        Ok(table) => table,
+/// Opens a table with the cache sizes of the connection, and reads its schema.
+async fn open_table_with_schema(
+    handle: &LanceDBConnection,
+    table_name: &str,
+) -> Option<(lancedb::Table, SchemaRef)> {
+    let mut builder = handle.connection.open_table(table_name);
+    if handle.index_cache_size != 0 || handle.metadata_cache_size != 0 {
+        let mut params = ReadParams::default();
+        if handle.index_cache_size != 0 {
+            params.index_cache_size = handle.index_cache_size;
+        }
+        if handle.metadata_cache_size != 0 {
+            params.metadata_cache_size = handle.metadata_cache_size;
+        }
+        builder = builder.lance_read_params(params);
+    }
+    let table = async {
+        let table = builder.execute().await?;
+        let schema = table.schema().await?;
+        Ok::<_, lancedb::Error>((table, schema))
+    };
+    match table.await {
+        Ok(table) => Some(table),
         Err(e) => {
             eprintln!("Failed to open table: {}", e);
-            return false;
+            None
         }
+    }
+}
+
+/// Builds a string or binary array from the contiguous layout (one values buffer and
+/// data_count + 1 offsets). The values are copied at once, and validated at once for strings.
+fn contiguous_to_byte_array<T: ByteArrayType<Offset = i32>>(field_data: &lancedb_field_data_t) -> GenericByteArray<T> {
+    use std::slice;
+
+    let offsets = unsafe { slice::from_raw_parts(field_data.offsets, field_data.data_count + 1) };
+    let (start, end) = (offsets[0], offsets[field_data.data_count]);
+    assert!(start <= end && end - start <= i32::MAX as usize, "Invalid offsets");
+    let values = if end > start {
+        unsafe {
+            assert!(!field_data.data.is_null());
+            slice::from_raw_parts((field_data.data as *const u8).add(start), end - start)
+        }
+    } else {
+        &[]
     };
+    let offsets: Vec<i32> = offsets.iter().map(|&offset| (offset - start) as i32).collect();
+    GenericByteArray::<T>::try_new(OffsetBuffer::new(ScalarBuffer::from(offsets)), Buffer::from_slice_ref(values), None)
+        .expect("Invalid string or binary data")
+}
 
-    // println!("field_data.num_fields: {:?}", field_data.num_fields);
+/// Copies a string or binary array to the contiguous C layout, returns the values and the
+/// offsets buffers.
+fn byte_array_to_contiguous<T: ByteArrayType<Offset = i32>>(array: &GenericByteArray<T>) -> (*mut c_void, *mut usize) {
+    let offsets = array.value_offsets();
+    let start = offsets[0] as usize;
+    let end = offsets[offsets.len() - 1] as usize;
+    // at least one byte, the buffer is released with free() by lancedb_free_search_results
+    let mut values = vec![0u8; std::cmp::max(end - start, 1)];
+    values[..end - start].copy_from_slice(&array.value_data()[start..end]);
+    let offsets: Vec<usize> = offsets.iter().map(|&offset| offset as usize - start).collect();
+    (Box::into_raw(values.into_boxed_slice()) as *mut c_void,
+     Box::into_raw(offsets.into_boxed_slice()) as *mut usize)
+}
+
+/// Converts the C field data into arrow arrays, in the same order as the fields.
+fn field_data_to_arrays(data: &[lancedb_field_data_t]) -> Vec<ArrayRef> {
+    use std::slice;
 
     let mut arrays: Vec<Arc<dyn Array>> = Vec::new();
 
@@ -406,7 +765,8 @@ pub extern "C" fn lancedb_insert(
                         assert!(!raw_data.is_null());
                         slice::from_raw_parts(raw_data, field_data.data_count as usize)
                     };
-                    let array = Arc::new(<$array_type>::from_iter_values(rust_data.iter().map(|&v| (v))));
+                    // one memcpy into the arrow buffer, the Vec is taken over without copying
+                    let array = Arc::new(<$array_type>::from(rust_data.to_vec()));
                     arrays.push(array);
                 };
             }
@@ -444,6 +804,12 @@ pub extern "C" fn lancedb_insert(
                 lancedb_field_data_type_t::LanceDBFieldTypeFloat64 => {
                     create_array_for_scalar!(Float64Array, f64);
                 }
+                lancedb_field_data_type_t::LanceDBFieldTypeString if !field_data.offsets.is_null() => {
+                    arrays.push(Arc::new(contiguous_to_byte_array::<Utf8Type>(field_data)));
+                }
+                lancedb_field_data_type_t::LanceDBFieldTypeBlob if !field_data.offsets.is_null() => {
+                    arrays.push(Arc::new(contiguous_to_byte_array::<BinaryType>(field_data)));
+                }
                 lancedb_field_data_type_t::LanceDBFieldTypeString => {
                     // Create arrow_array to represent a string
                     let raw_data = field_data.data as *mut *const c_char;
@@ -501,12 +867,11 @@ pub extern "C" fn lancedb_insert(
                         assert!(!raw_data.is_null());
                         slice::from_raw_parts(raw_data, (field_data.data_count * dimension) as usize)
                     };
-                    let dimensionv: usize = *dimension;
-                    let arr = Arc::new(FixedSizeListArray::from_iter_primitive::<$data_type, _, _>(
-                            rust_data.chunks(dimensionv).map(
-                                |chunk| Some(chunk.iter().map(|&v| Some(v)).collect::<Vec<_>>())),
-                            field_data.dimension as i32,
-                        ));
+                    // the rows are contiguous, so the values are copied into a single child
+                    // array at once instead of being collected row by row
+                    let values = Arc::new(PrimitiveArray::<$data_type>::from(rust_data.to_vec()));
+                    let item = Arc::new(Field::new("item", values.data_type().clone(), true));
+                    let arr = Arc::new(FixedSizeListArray::try_new(item, *dimension as i32, values, None).unwrap());
                     // print!("insert array: {:?}", arr);
                     arrays.push(arr)
                 };
@@ -561,19 +926,99 @@ pub extern "C" fn lancedb_insert(
         // arrays.push(array.unwrap());
     }
 
+    arrays
+}
+
+/// Converts the C data into arrow arrays. The caller memory is not referenced afterwards.
+fn c_data_to_arrays(field_data: *mut lancedb_data_t) -> Vec<ArrayRef> {
+    use std::slice;
+
+    let field_data = unsafe {
+        assert!(!field_data.is_null());
+        &*field_data
+    };
+
+    // Convert the field_data to a Rust vector of Fields
+    let data = unsafe {
+        slice::from_raw_parts(field_data.fields as *const lancedb_field_data_t, field_data.num_fields)
+    };
+
+    // println!("field_data.num_fields: {:?}", field_data.num_fields);
+
+    field_data_to_arrays(data)
+}
+
+/// Converts f32 values to f16, with the conversion instructions of the CPU when it has them
+/// (F16C on x86, FP16 on aarch64), detected at run time.
+fn f32_to_f16_array(values: &Float32Array) -> Float16Array {
+    use half::slice::HalfFloatSliceExt;
+
+    let mut converted = vec![half::f16::ZERO; values.len()];
+    converted.convert_from_f32_slice(values.values());
+    Float16Array::from(converted)
+}
+
+/// Makes a record batch of `schema` from the arrays of C field data. f32 data given for f16
+/// columns, scalar or vector, is converted, so f32 embeddings can be stored as f16.
+fn c_arrays_to_batch(schema: SchemaRef, arrays: Vec<ArrayRef>) -> Result<RecordBatch, ArrowError> {
+    if arrays.len() != schema.fields().len() {
+        return RecordBatch::try_new(schema, arrays);
+    }
+    let mut columns = Vec::with_capacity(arrays.len());
+    for (array, field) in arrays.into_iter().zip(schema.fields().iter()) {
+        let column: ArrayRef = match (array.data_type(), field.data_type()) {
+            (DataType::Float32, DataType::Float16) => {
+                Arc::new(f32_to_f16_array(array.as_primitive::<Float32Type>()))
+            }
+            (FixedSizeList(item, dim), FixedSizeList(target_item, _))
+                if item.data_type() == &DataType::Float32 && target_item.data_type() == &DataType::Float16 => {
+                let list = array.as_fixed_size_list();
+                let values = f32_to_f16_array(list.values().as_primitive::<Float32Type>());
+                Arc::new(FixedSizeListArray::try_new(target_item.clone(), *dim, Arc::new(values), list.nulls().cloned())?)
+            }
+            _ => array,
+        };
+        columns.push(column);
+    }
+    RecordBatch::try_new(schema, columns)
+}
+
+/// Appends the arrays as one batch to an opened table, whose schema is given by `schema`.
+async fn add_arrays(table: &lancedb::Table, schema: SchemaRef, arrays: Vec<ArrayRef>) -> bool {
     // Create a RecordBatch stream
-    let schema = rt.block_on(async {
-        return table.schema().await.unwrap();
-    });
+    let batch = match c_arrays_to_batch(schema.clone(), arrays) {
+        Ok(batch) => batch,
+        Err(e) => {
+            eprintln!("Failed to create record batch: {}", e);
+            return false;
+        }
+    };
+    add_batches(table, schema, vec![batch]).await
+}
 
-    let batches =
-        RecordBatchIterator::new(
-            vec![Ok(RecordBatch::try_new( schema.clone(), arrays).unwrap())].into_iter(),
-            schema.clone());
+/// Appends the batches to the table in a single commit.
+async fn add_batches(table: &lancedb::Table, schema: SchemaRef, batches: Vec<RecordBatch>) -> bool {
+    add_batches_with_params(table, schema, batches, None).await
+}
 
-    let result = rt.block_on(async {
-        return table.add(Box::new(batches)).execute().await;
-    });
+/// Same as `add_batches`, with lance write parameters. The batches replace the table data if
+/// the parameters are in overwrite mode.
+async fn add_batches_with_params(
+    table: &lancedb::Table,
+    schema: SchemaRef,
+    batches: Vec<RecordBatch>,
+    params: Option<WriteParams>,
+) -> bool {
+    let batches = RecordBatchIterator::new(batches.into_iter().map(Ok), schema);
+
+    let mut add = table.add(Box::new(batches));
+    if let Some(params) = params {
+        if let WriteMode::Overwrite = params.mode {
+            add = add.mode(AddDataMode::Overwrite);
+        }
+        add = add.write_options(WriteOptions { lance_write_params: Some(params) });
+    }
+    let result = add.execute().await;
     match result {
         Ok(_) => true,
         Err(e) => {
@@ -583,406 +1028,2429 @@ pub extern "C" fn lancedb_insert(
     }
 }
 
+/// Appends the field data to an opened table, whose schema is given by `schema`.
+fn insert_into_table(
+    rt: &Runtime,
+    table: &lancedb::Table,
+    schema: SchemaRef,
+    field_data: *mut lancedb_data_t,
+) -> bool {
+    let arrays = c_data_to_arrays(field_data);
+    rt.block_on(add_arrays(table, schema, arrays))
+}
 
-fn convert_to_i32_vec(array: &ArrayRef) -> Result<Vec<i32>, std::io::Error> {
-    let int32_array = array.as_any().downcast_ref::<Int32Array>().unwrap();
-    let mut vec = Vec::new();
-    for i in 0..int32_array.len() {
-        let value = int32_array.value(i);
-        vec.push(value);
-    }
+#[no_mangle]
+pub extern "C" fn lancedb_insert(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    field_data: *mut lancedb_data_t,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
 
-    Ok(vec)
-}
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
 
-fn string_to_c_char_ptr(s: String) -> *mut c_char {
-    let c_string = CString::new(s).unwrap();
-    c_string.into_raw()
+    // Insert the data into the table
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+
+    insert_into_table(rt, &table, schema, field_data)
 }
 
 #[no_mangle]
-pub extern "C" fn lancedb_search(
+pub extern "C" fn lancedb_upsert(
     connection_ptr: *mut c_void,
     table_name: *const c_char,
-    column_name: *const c_char,
-    data: *const c_void,
-    dimension: i32,
-    search_results: *mut lancedb_data_t,
+    key_column: *const c_char,
+    field_data: *mut lancedb_data_t,
+    mode: lancedb_upsert_mode_t,
 ) -> bool {
-    use std::slice;
-
     // Convert C types to Rust types
     let table_name = unsafe {
         assert!(!table_name.is_null());
         CStr::from_ptr(table_name).to_str().unwrap()
     };
-    let column_name = unsafe {
-        assert!(!column_name.is_null());
-        CStr::from_ptr(column_name).to_str().unwrap()
+    let key_column = unsafe {
+        assert!(!key_column.is_null());
+        CStr::from_ptr(key_column).to_str().unwrap()
     };
 
-    // Get the connection from the HashMap
-    let connections = CONNECTIONS.lock().unwrap();
-    let send_ptr = SendPtr(connection_ptr, PhantomData);
-    let send_ptr = connections.get(&send_ptr).unwrap();
-    let connection = unsafe { &mut *(send_ptr.0 as *mut Connection) };
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
 
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+    if schema.field_with_name(key_column).is_err() {
+        eprintln!("Key column not found: {}", key_column);
+        return false;
+    }
+
+    let arrays = c_data_to_arrays(field_data);
+    let batch = match c_arrays_to_batch(schema.clone(), arrays) {
+        Ok(batch) => batch,
+        Err(e) => {
+            eprintln!("Failed to create record batch: {}", e);
+            return false;
+        }
+    };
+    let batches = RecordBatchIterator::new(vec![batch].into_iter().map(Ok), schema);
+
+    // Rows are matched on the key column, and the whole table is updated in one commit
+    let mut merge_insert = table.merge_insert(&[key_column]);
+    match mode {
+        lancedb_upsert_mode_t::LanceDBUpsertUpdateOrInsert => {
+            merge_insert.when_matched_update_all(None).when_not_matched_insert_all();
+        }
+        lancedb_upsert_mode_t::LanceDBUpsertUpdateOnly => {
+            merge_insert.when_matched_update_all(None);
+        }
+        lancedb_upsert_mode_t::LanceDBUpsertInsertOnly => {
+            merge_insert.when_not_matched_insert_all();
+        }
+    }
+    match rt.block_on(merge_insert.execute(Box::new(batches))) {
+        Ok(_) => true,
+        Err(e) => {
+            eprintln!("Failed to upsert data: {}", e);
+            false
+        }
+    }
+}
+
+const DEFAULT_PRUNE_OLDER_THAN_SECS: u64 = 7 * 24 * 3600;
+/// `LANCEDB_PRUNE_DEFAULT_AGE` of lancedb.h.
+const LANCEDB_PRUNE_DEFAULT_AGE: u64 = u64::MAX;
+/// Longest age `chrono::Duration::seconds` takes.
+const MAX_PRUNE_OLDER_THAN_SECS: u64 = (i64::MAX / 1000) as u64;
+
+#[no_mangle]
+pub extern "C" fn lancedb_optimize(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    options: *const lancedb_optimize_options_t,
+    stats: *mut lancedb_optimize_stats_t,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let (compact, target_rows_per_fragment, prune, prune_older_than_secs, optimize_indices) =
+        match unsafe { options.as_ref() } {
+            Some(options) => (options.compact != 0, options.target_rows_per_fragment, options.prune != 0,
+                              options.prune_older_than_secs, options.optimize_indices != 0),
+            None => (true, 0, true, LANCEDB_PRUNE_DEFAULT_AGE, true),
+        };
+    // 0 is a valid age, which prunes every version but the latest
+    let prune_older_than_secs = if prune_older_than_secs != LANCEDB_PRUNE_DEFAULT_AGE {
+        prune_older_than_secs.min(MAX_PRUNE_OLDER_THAN_SECS)
+    } else {
+        DEFAULT_PRUNE_OLDER_THAN_SECS
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let (table, _) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+
+    let start = Instant::now();
+    let mut result = lancedb_optimize_stats_t::default();
+    let mut actions = Vec::new();
+    // Compaction first, so that the versions it replaces can be pruned right away
+    if compact {
+        let mut options = CompactionOptions::default();
+        if target_rows_per_fragment != 0 {
+            options.target_rows_per_fragment = target_rows_per_fragment;
+        }
+        actions.push(OptimizeAction::Compact { options, remap_options: None });
+    }
+    if prune {
+        let older_than = chrono::Duration::seconds(prune_older_than_secs as i64);
+        actions.push(OptimizeAction::Prune { older_than, delete_unverified: None });
+    }
+    if optimize_indices {
+        actions.push(OptimizeAction::Index(OptimizeOptions::default()));
+    }
+    for action in actions {
+        match rt.block_on(table.optimize(action)) {
+            Ok(optimize_stats) => {
+                if let Some(compaction) = optimize_stats.compaction {
+                    result.fragments_removed += compaction.fragments_removed as u64;
+                    result.fragments_added += compaction.fragments_added as u64;
+                    result.files_removed += compaction.files_removed as u64;
+                    result.files_added += compaction.files_added as u64;
+                }
+                if let Some(prune) = optimize_stats.prune {
+                    result.versions_removed += prune.old_versions;
+                    result.bytes_removed += prune.bytes_removed;
+                }
+            }
+            Err(e) => {
+                eprintln!("Failed to optimize table: {}", e);
+                return false;
+            }
+        }
+    }
+    result.elapsed_ms = start.elapsed().as_millis() as u64;
+
+    if let Some(stats) = unsafe { stats.as_mut() } {
+        *stats = result;
+    }
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_create_index(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    column_name: *const c_char,
+    options: *const lancedb_index_options_t,
+) -> bool {
+    use lancedb::index::Index;
+    use lancedb::index::vector::IvfPqIndexBuilder;
+
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let column_name = unsafe {
+        assert!(!column_name.is_null());
+        CStr::from_ptr(column_name).to_str().unwrap()
+    };
+
+    let mut builder = IvfPqIndexBuilder::default();
+    if let Some(options) = unsafe { options.as_ref() } {
+        builder = builder.distance_type(options.distance_type.to_distance_type());
+        if options.num_partitions != 0 {
+            builder = builder.num_partitions(options.num_partitions);
+        }
+        if options.num_sub_vectors != 0 {
+            builder = builder.num_sub_vectors(options.num_sub_vectors);
+        }
+    } else {
+        builder = builder.distance_type(lancedb::DistanceType::Cosine);
+    }
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+    if schema.index_of(column_name).is_err() {
+        eprintln!("Failed to find column: {}", column_name);
+        return false;
+    }
+
+    let result = rt.block_on(async {
+        table.create_index(&[column_name], Index::IvfPq(builder))
+            .execute()
+            .await
+    });
+    match result {
+        Ok(()) => true,
+        Err(e) => {
+            eprintln!("Failed to create index: {}", e);
+            false
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_insert_with_options(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    field_data: *mut lancedb_data_t,
+    options: *const lancedb_write_options_t,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+
+    let arrays = c_data_to_arrays(field_data);
+    let batch = match c_arrays_to_batch(schema.clone(), arrays) {
+        Ok(batch) => batch,
+        Err(e) => {
+            eprintln!("Failed to create record batch: {}", e);
+            return false;
+        }
+    };
+    let params = c_write_params(options, false);
+    rt.block_on(add_batches_with_params(&table, schema, vec![batch], Some(params)))
+}
+
+/// Imports a record batch exported through the Arrow C data interface. The buffers are
+/// not copied; `array` is moved out of (and marked released), `schema` is only borrowed.
+unsafe fn import_record_batch(
+    array: *mut FFI_ArrowArray,
+    schema: *const FFI_ArrowSchema,
+) -> Result<RecordBatch, ArrowError> {
+    let array = FFI_ArrowArray::from_raw(array);
+    let data = from_ffi(array, &*schema)?;
+    match make_array(data).as_struct_opt() {
+        Some(struct_array) => Ok(RecordBatch::from(struct_array.clone())),
+        None => Err(ArrowError::InvalidArgumentError(
+            "Expected a struct array of the record batch columns".to_string())),
+    }
+}
+
+/// Matches the columns of an imported batch with the table columns by name, in the table
+/// order, so that a batch with another column order or nullability is checked up front
+/// instead of failing inside lance.
+fn batch_to_table_schema(batch: RecordBatch, schema: &SchemaRef) -> Result<RecordBatch, String> {
+    if batch.num_columns() != schema.fields().len() {
+        return Err(format!("{} columns given, the table has {}", batch.num_columns(), schema.fields().len()));
+    }
+    let mut columns = Vec::with_capacity(schema.fields().len());
+    for field in schema.fields() {
+        let column = batch.column_by_name(field.name())
+            .ok_or(format!("no data for the column: {}", field.name()))?;
+        let column = match (column.data_type(), field.data_type()) {
+            (data_type, expected) if data_type == expected => column.clone(),
+            // same vector type, with another item field name or nullability. Items with nulls
+            // are still refused by try_new if the table items are not nullable.
+            (FixedSizeList(column_item, size), FixedSizeList(item, expected_size))
+                if size == expected_size && column_item.data_type() == item.data_type() => {
+                let list = column.as_fixed_size_list();
+                Arc::new(FixedSizeListArray::try_new(item.clone(), *size, list.values().clone(), list.nulls().cloned())
+                    .map_err(|e| e.to_string())?)
+            }
+            (data_type, expected) => {
+                return Err(format!("column {} is {}, {} is expected", field.name(), data_type, expected));
+            }
+        };
+        columns.push(column);
+    }
+    // also checks that the columns not nullable in the table have no nulls
+    RecordBatch::try_new(schema.clone(), columns).map_err(|e| e.to_string())
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_insert_arrow(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    array: *mut FFI_ArrowArray,
+    schema: *mut FFI_ArrowSchema,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    // Imported first, so that the array is released on every path
+    let batch = unsafe {
+        assert!(!array.is_null() && !schema.is_null());
+        match import_record_batch(array, schema) {
+            Ok(batch) => batch,
+            Err(e) => {
+                eprintln!("Failed to import arrow array: {}", e);
+                return false;
+            }
+        }
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let (table, table_schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+
+    let batch = match batch_to_table_schema(batch, &table_schema) {
+        Ok(batch) => batch,
+        Err(e) => {
+            eprintln!("Failed to insert arrow array: {}", e);
+            return false;
+        }
+    };
+    rt.block_on(add_batches(&table, table_schema, vec![batch]))
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_insert_arrow_stream(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    stream: *mut FFI_ArrowArrayStream,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let reader = unsafe {
+        assert!(!stream.is_null());
+        match ArrowArrayStreamReader::from_raw(stream) {
+            Ok(reader) => reader,
+            Err(e) => {
+                eprintln!("Failed to import arrow stream: {}", e);
+                return false;
+            }
+        }
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let (table, table_schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+
+    // The batches are pulled from the stream while they are written, in one commit
+    let schema = table_schema.clone();
+    let batches = reader.map(move |batch| batch.and_then(|batch| {
+        batch_to_table_schema(batch, &schema).map_err(ArrowError::InvalidArgumentError)
+    }));
+    let reader = RecordBatchIterator::new(batches, table_schema);
+    match rt.block_on(table.add(Box::new(reader)).execute()) {
+        Ok(_) => true,
+        Err(e) => {
+            eprintln!("Failed to insert data: {}", e);
+            false
+        }
+    }
+}
+
+
+/// Producer of the batches of a streaming insert, see `lancedb_batch_producer_t`.
+type lancedb_batch_producer_t = Option<unsafe extern "C" fn(*mut c_void, *mut lancedb_data_t) -> i32>;
+
+/// Record batch reader pulling the batches from a C producer. Each batch is copied into
+/// arrow arrays when it is pulled, so only the batch being written is held in memory.
+struct BatchProducerReader {
+    producer: unsafe extern "C" fn(*mut c_void, *mut lancedb_data_t) -> i32,
+    user_data: SendPtr,
+    schema: SchemaRef,
+    done: bool,
+}
+
+impl Iterator for BatchProducerReader {
+    type Item = Result<RecordBatch, ArrowError>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.done {
+            return None;
+        }
+        let mut batch = lancedb_data_t { fields: null_mut(), num_fields: 0 };
+        match unsafe { (self.producer)(self.user_data.0, &mut batch) } {
+            1 if batch.fields.is_null() => {
+                self.done = true;
+                Some(Err(ArrowError::InvalidArgumentError("The batch producer returned no fields".to_string())))
+            }
+            1 => {
+                let arrays = c_data_to_arrays(&mut batch);
+                let result = c_arrays_to_batch(self.schema.clone(), arrays);
+                self.done = result.is_err();
+                Some(result)
+            }
+            0 => {
+                self.done = true;
+                None
+            }
+            _ => {
+                self.done = true;
+                Some(Err(ArrowError::InvalidArgumentError("The batch producer failed".to_string())))
+            }
+        }
+    }
+}
+
+impl RecordBatchReader for BatchProducerReader {
+    fn schema(&self) -> SchemaRef {
+        self.schema.clone()
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_insert_stream(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    producer: lancedb_batch_producer_t,
+    user_data: *mut c_void,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let producer = match producer {
+        Some(producer) => producer,
+        None => return false,
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+
+    let reader = BatchProducerReader { producer, user_data: SendPtr(user_data), schema, done: false };
+    match rt.block_on(table.add(Box::new(reader)).execute()) {
+        Ok(_) => true,
+        Err(e) => {
+            eprintln!("Failed to insert data: {}", e);
+            false
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_create_table_stream(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    schema: *mut lancedb_schema_t,
+    producer: lancedb_batch_producer_t,
+    user_data: *mut c_void,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let producer = match producer {
+        Some(producer) => producer,
+        None => return false,
+    };
+    let schema = c_schema_to_schema(schema);
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let reader = BatchProducerReader { producer, user_data: SendPtr(user_data), schema, done: false };
+    match rt.block_on(handle.connection.create_table(table_name, Box::new(reader)).execute()) {
+        Ok(_) => true,
+        Err(e) => {
+            eprintln!("Failed to create table: {}", e);
+            false
+        }
+    }
+}
+
+
+/// Read-only memory mapping of a whole file, unmapped on drop.
+struct MappedFile {
+    ptr: *mut c_void,
+    len: usize,
+}
+
+unsafe impl Send for MappedFile {}
+
+impl MappedFile {
+    fn open(path: &str) -> std::io::Result<MappedFile> {
+        use std::os::unix::io::AsRawFd;
+
+        let file = std::fs::File::open(path)?;
+        let len = file.metadata()?.len() as usize;
+        if len == 0 {
+            return Err(std::io::Error::new(std::io::ErrorKind::InvalidData, "empty file"));
+        }
+        let ptr = unsafe {
+            libc::mmap(null_mut(), len, libc::PROT_READ, libc::MAP_PRIVATE, file.as_raw_fd(), 0)
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(std::io::Error::last_os_error());
+        }
+        // The file is read front to back once, let the kernel read ahead and drop pages behind
+        unsafe {
+            libc::madvise(ptr, len, libc::MADV_SEQUENTIAL);
+        }
+        Ok(MappedFile { ptr, len })
+    }
+
+    fn bytes(&self) -> &[u8] {
+        unsafe { std::slice::from_raw_parts(self.ptr as *const u8, self.len) }
+    }
+}
+
+impl Drop for MappedFile {
+    fn drop(&mut self) {
+        unsafe {
+            libc::munmap(self.ptr, self.len);
+        }
+    }
+}
+
+/// Where the vectors are in a mapped file: `num_rows` rows of `dimension` f32 values, starting
+/// at `data_offset`, `row_stride` bytes apart, each after a `row_header` bytes row header.
+struct VectorFileLayout {
+    data_offset: usize,
+    row_stride: usize,
+    row_header: usize,
+    dimension: usize,
+    num_rows: usize,
+}
+
+/// Parses the header of a .npy file holding a 2D little-endian float32 array in C order.
+fn parse_npy_header(bytes: &[u8]) -> Result<VectorFileLayout, String> {
+    if bytes.len() < 10 || &bytes[0..6] != b"\x93NUMPY" {
+        return Err("not a npy file".to_string());
+    }
+    let (header_len, header_start) = if bytes[6] == 1 {
+        (u16::from_le_bytes([bytes[8], bytes[9]]) as usize, 10)
+    } else if bytes.len() >= 12 {
+        (u32::from_le_bytes([bytes[8], bytes[9], bytes[10], bytes[11]]) as usize, 12)
+    } else {
+        return Err("truncated npy header".to_string());
+    };
+    let header = bytes.get(header_start..header_start + header_len)
+        .and_then(|header| std::str::from_utf8(header).ok())
+        .ok_or("truncated npy header")?;
+
+    let value_of = |key: &str| header.find(key).map(|pos| header[pos + key.len()..].trim_start_matches([':', ' ']));
+    let descr = value_of("'descr'").ok_or("no descr in npy header")?;
+    if !descr.starts_with("'<f4'") {
+        return Err(format!("unsupported npy dtype, float32 is expected: {}", header));
+    }
+    if !value_of("'fortran_order'").map_or(false, |order| order.starts_with("False")) {
+        return Err("fortran ordered npy arrays are not supported".to_string());
+    }
+    let shape = value_of("'shape'").and_then(|shape| {
+        let shape = shape.strip_prefix('(')?;
+        shape.get(..shape.find(')')?)
+    }).ok_or("no shape in npy header")?;
+    let dims: Vec<usize> = shape.split(',').map(str::trim).filter(|dim| !dim.is_empty())
+        .map(|dim| dim.parse::<usize>()).collect::<Result<_, _>>().map_err(|e| e.to_string())?;
+    if dims.len() != 2 {
+        return Err(format!("a 2D array is expected, shape is ({})", shape));
+    }
+
+    Ok(VectorFileLayout {
+        data_offset: header_start + header_len,
+        row_stride: dims[1].checked_mul(mem::size_of::<f32>()).ok_or("npy dimension is too large")?,
+        row_header: 0,
+        dimension: dims[1],
+        num_rows: dims[0],
+    })
+}
+
+/// Works out the vector layout of a mapped file, and checks that the file holds all of it.
+fn vector_file_layout(
+    bytes: &[u8],
+    format: lancedb_vector_format_t,
+    dimension: usize,
+    header_size: usize,
+) -> Result<VectorFileLayout, String> {
+    let layout = match format {
+        lancedb_vector_format_t::LanceDBVectorFormatFvecs => {
+            // every row is an int32 dimension followed by the values
+            if bytes.len() < 4 {
+                return Err("truncated fvecs file".to_string());
+            }
+            let dimension = i32::from_le_bytes([bytes[0], bytes[1], bytes[2], bytes[3]]);
+            if dimension <= 0 {
+                return Err(format!("invalid fvecs dimension: {}", dimension));
+            }
+            let dimension = dimension as usize;
+            let row_stride = dimension.checked_mul(mem::size_of::<f32>()).and_then(|size| size.checked_add(4))
+                .filter(|row_stride| *row_stride <= bytes.len())
+                .ok_or(format!("fvecs dimension {} does not fit in the file", dimension))?;
+            if bytes.len() % row_stride != 0 {
+                return Err("truncated file".to_string());
+            }
+            VectorFileLayout { data_offset: 0, row_stride, row_header: 4, dimension, num_rows: bytes.len() / row_stride }
+        }
+        lancedb_vector_format_t::LanceDBVectorFormatNpy => parse_npy_header(bytes)?,
+        lancedb_vector_format_t::LanceDBVectorFormatRaw => {
+            if dimension == 0 {
+                return Err("the dimension is required for raw files".to_string());
+            }
+            let row_stride = dimension.checked_mul(mem::size_of::<f32>()).ok_or("dimension is too large")?;
+            let data_size = bytes.len().saturating_sub(header_size);
+            if data_size % row_stride != 0 {
+                return Err("truncated file".to_string());
+            }
+            let num_rows = data_size / row_stride;
+            VectorFileLayout { data_offset: header_size, row_stride, row_header: 0, dimension, num_rows }
+        }
+    };
+    if layout.dimension == 0 || layout.num_rows == 0 {
+        return Err("no vectors in the file".to_string());
+    }
+    if dimension != 0 && dimension != layout.dimension {
+        return Err(format!("dimension is {} in the file, {} is expected", layout.dimension, dimension));
+    }
+    let data_end = layout.num_rows.checked_mul(layout.row_stride)
+        .and_then(|size| size.checked_add(layout.data_offset));
+    if data_end.map_or(true, |data_end| data_end > bytes.len()) {
+        return Err("truncated file".to_string());
+    }
+    Ok(layout)
+}
+
+/// Record batch reader over the vectors of a mapped file, `chunk_rows` rows per batch. Only
+/// the batch being written is held in memory, the file pages are read on demand.
+struct VectorFileReader {
+    file: MappedFile,
+    layout: VectorFileLayout,
+    schema: SchemaRef,
+    vector_column: String,
+    id_column: Option<String>,
+    first_id: i64,
+    chunk_rows: usize,
+    next_row: usize,
+}
+
+impl VectorFileReader {
+    fn read_batch(&self, first_row: usize, num_rows: usize) -> Result<RecordBatch, ArrowError> {
+        let layout = &self.layout;
+        let bytes = self.file.bytes();
+        let row_bytes = layout.dimension * mem::size_of::<f32>();
+        let mut values: Vec<f32> = Vec::with_capacity(num_rows * layout.dimension);
+        let dst = values.as_mut_ptr() as *mut u8;
+        if layout.row_header == 0 {
+            // rows are contiguous, copy the whole chunk at once
+            let start = layout.data_offset + first_row * layout.row_stride;
+            unsafe { std::ptr::copy_nonoverlapping(bytes[start..].as_ptr(), dst, num_rows * row_bytes) };
+        } else {
+            for row in 0..num_rows {
+                let start = layout.data_offset + (first_row + row) * layout.row_stride;
+                let header = &bytes[start..start + layout.row_header];
+                if i32::from_le_bytes([header[0], header[1], header[2], header[3]]) as usize != layout.dimension {
+                    return Err(ArrowError::InvalidArgumentError(
+                        format!("row {} has a different dimension", first_row + row)));
+                }
+                let src = &bytes[start + layout.row_header..start + layout.row_header + row_bytes];
+                unsafe { std::ptr::copy_nonoverlapping(src.as_ptr(), dst.add(row * row_bytes), row_bytes) };
+            }
+        }
+        unsafe { values.set_len(num_rows * layout.dimension) };
+
+        let item = Arc::new(Field::new("item", DataType::Float32, true));
+        let vectors: ArrayRef = Arc::new(FixedSizeListArray::try_new(
+            item, layout.dimension as i32, Arc::new(Float32Array::from(values)), None)?);
+
+        let first_id = self.first_id + first_row as i64;
+        let mut columns: Vec<ArrayRef> = Vec::new();
+        for field in self.schema.fields() {
+            let column: ArrayRef = if field.name() == &self.vector_column {
+                vectors.clone()
+            } else if Some(field.name()) == self.id_column.as_ref() {
+                match field.data_type() {
+                    DataType::Int32 => Arc::new(Int32Array::from_iter_values(
+                        (first_id..first_id + num_rows as i64).map(|id| id as i32))),
+                    DataType::Int64 => Arc::new(Int64Array::from_iter_values(first_id..first_id + num_rows as i64)),
+                    data_type => return Err(ArrowError::InvalidArgumentError(
+                        format!("id column has an unsupported type: {}", data_type))),
+                }
+            } else if field.is_nullable() {
+                arrow_array::new_null_array(field.data_type(), num_rows)
+            } else {
+                return Err(ArrowError::InvalidArgumentError(
+                    format!("no data for the column: {}", field.name())));
+            };
+            columns.push(column);
+        }
+        RecordBatch::try_new(self.schema.clone(), columns)
+    }
+}
+
+impl Iterator for VectorFileReader {
+    type Item = Result<RecordBatch, ArrowError>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.next_row >= self.layout.num_rows {
+            return None;
+        }
+        let num_rows = std::cmp::min(self.chunk_rows, self.layout.num_rows - self.next_row);
+        let batch = self.read_batch(self.next_row, num_rows);
+        self.next_row = if batch.is_ok() { self.next_row + num_rows } else { self.layout.num_rows };
+        Some(batch)
+    }
+}
+
+impl RecordBatchReader for VectorFileReader {
+    fn schema(&self) -> SchemaRef {
+        self.schema.clone()
+    }
+}
+
+const DEFAULT_IMPORT_CHUNK_ROWS: usize = 8192;
+
+#[no_mangle]
+pub extern "C" fn lancedb_import_vectors(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    path: *const c_char,
+    format: lancedb_vector_format_t,
+    options: *const lancedb_import_options_t,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let path = unsafe {
+        assert!(!path.is_null());
+        CStr::from_ptr(path).to_str().unwrap()
+    };
+    let c_str_option = |s: *const c_char| -> Option<String> {
+        if s.is_null() { None } else { Some(unsafe { CStr::from_ptr(s) }.to_str().unwrap().to_string()) }
+    };
+    let options = unsafe { options.as_ref() };
+    let vector_column = options.and_then(|o| c_str_option(o.vector_column)).unwrap_or("vector".to_string());
+    let id_column = options.and_then(|o| c_str_option(o.id_column));
+    let first_id = options.map_or(0, |o| o.first_id);
+    let dimension = options.map_or(0, |o| o.dimension);
+    let header_size = options.map_or(0, |o| o.header_size);
+    let chunk_rows = options.map_or(0, |o| o.chunk_rows);
+    let chunk_rows = if chunk_rows != 0 { chunk_rows } else { DEFAULT_IMPORT_CHUNK_ROWS };
+    let create_table = options.map_or(false, |o| o.create_table != 0);
+
+    let file = match MappedFile::open(path) {
+        Ok(file) => file,
+        Err(e) => {
+            eprintln!("Failed to map file {}: {}", path, e);
+            return false;
+        }
+    };
+    let layout = match vector_file_layout(file.bytes(), format, dimension, header_size) {
+        Ok(layout) => layout,
+        Err(e) => {
+            eprintln!("Failed to read vectors from {}: {}", path, e);
+            return false;
+        }
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    let table = if create_table {
+        None
+    } else {
+        match rt.block_on(open_table_with_schema(&handle, table_name)) {
+            Some(table) => Some(table),
+            None => return false,
+        }
+    };
+    let schema = match &table {
+        Some((_, schema)) => schema.clone(),
+        None => {
+            // same layout as lancedb_create_table
+            let mut fields = Vec::new();
+            if let Some(id_column) = &id_column {
+                fields.push(Field::new(id_column, DataType::Int32, false));
+            }
+            fields.push(Field::new(
+                &vector_column,
+                DataType::FixedSizeList(Arc::new(Field::new("item", DataType::Float32, true)),
+                                        layout.dimension as i32),
+                true,
+            ));
+            Arc::new(Schema::new(fields))
+        }
+    };
+
+    match schema.field_with_name(&vector_column).map(|field| field.data_type()) {
+        Ok(FixedSizeList(item, dim)) if item.data_type() == &DataType::Float32 && *dim as usize == layout.dimension => {}
+        Ok(data_type) => {
+            eprintln!("Column {} is {}, a float32 vector of dimension {} is expected",
+                      vector_column, data_type, layout.dimension);
+            return false;
+        }
+        Err(e) => {
+            eprintln!("Failed to find vector column: {}", e);
+            return false;
+        }
+    }
+
+    // The ids are checked up front, an Int32 id column does not wrap around
+    if let Some(id_column) = &id_column {
+        let last_id = first_id.checked_add(layout.num_rows as i64 - 1);
+        let fits = match schema.field_with_name(id_column).map(|field| field.data_type()) {
+            Ok(DataType::Int32) => last_id.map_or(false, |last_id| first_id >= i32::MIN as i64 && last_id <= i32::MAX as i64),
+            _ => last_id.is_some(),
+        };
+        if !fits {
+            eprintln!("Ids from {} for {} vectors overflow column {}", first_id, layout.num_rows, id_column);
+            return false;
+        }
+    }
+
+    let reader = VectorFileReader {
+        file,
+        layout,
+        schema,
+        vector_column,
+        id_column,
+        first_id,
+        chunk_rows,
+        next_row: 0,
+    };
+    // All the chunks go into a single commit
+    let result = match table {
+        Some((table, _)) => rt.block_on(table.add(Box::new(reader)).execute()),
+        None => rt.block_on(handle.connection.create_table(table_name, Box::new(reader)).execute()).map(|_| ()),
+    };
+    match result {
+        Ok(_) => true,
+        Err(e) => {
+            eprintln!("Failed to import vectors: {}", e);
+            false
+        }
+    }
+}
+
+fn string_to_c_char_ptr(s: String) -> *mut c_char {
+    let c_string = CString::new(s).unwrap();
+    c_string.into_raw()
+}
+
+/// Returns the element type of a vector (FixedSizeList) field, or None for scalar fields.
+fn vector_element_type(field: &Field) -> Option<DataType> {
+    match field.data_type() {
+        FixedSizeList(inner_ty, _) => Some(inner_ty.data_type().clone()),
+        _ => None,
+    }
+}
+
+/// Query vector borrowed from caller memory.
+enum QueryVector<'a> {
+    Float16(&'a [half::f16]),
+    Float32(&'a [f32]),
+    Float64(&'a [f64]),
+}
+
+/// Interprets `data` as a query vector for the vector field `field`. The caller memory
+/// has to stay valid for as long as the returned query is used.
+fn query_vector<'a>(field: &Field, data: SendPtr, dimension: i32) -> Option<QueryVector<'a>> {
+    use std::slice;
+
+    assert!(!data.0.is_null());
+    match vector_element_type(field) {
+        Some(DataType::Float16) => Some(QueryVector::Float16(unsafe {
+            slice::from_raw_parts(data.0 as *const half::f16, dimension as usize)
+        })),
+        Some(DataType::Float32) => Some(QueryVector::Float32(unsafe {
+            slice::from_raw_parts(data.0 as *const f32, dimension as usize)
+        })),
+        Some(DataType::Float64) => Some(QueryVector::Float64(unsafe {
+            slice::from_raw_parts(data.0 as *const f64, dimension as usize)
+        })),
+        Some(data_type) => {
+            eprintln!("Unsupported vector data type: {:?}", data_type);
+            None
+        },
+        None => {
+            eprintln!("Not a vector field: {}", field.name());
+            None
+        }
+    }
+}
+
+/// Search parameters from the C search options, `None` keeps the lancedb default.
+#[derive(Clone)]
+struct SearchOptions {
+    limit: Option<usize>,
+    nprobes: Option<usize>,
+    refine_factor: Option<u32>,
+    distance_type: lancedb::DistanceType,
+    select_columns: Option<Vec<String>>,
+    filter: Option<String>,
+    postfilter: bool,
+}
+
+impl Default for SearchOptions {
+    fn default() -> Self {
+        SearchOptions {
+            limit: None,
+            nprobes: None,
+            refine_factor: None,
+            distance_type: lancedb::DistanceType::Cosine,
+            select_columns: None,
+            filter: None,
+            postfilter: false,
+        }
+    }
+}
+
+fn c_search_options(options: *const lancedb_search_options_t) -> SearchOptions {
+    let options = match unsafe { options.as_ref() } {
+        Some(options) => options,
+        None => return SearchOptions::default(),
+    };
+    let select_columns = if options.select_columns.is_null() {
+        None
+    } else {
+        let names = unsafe { std::slice::from_raw_parts(options.select_columns, options.num_select_columns) };
+        Some(names.iter().map(|name| unsafe {
+            assert!(!name.is_null());
+            CStr::from_ptr(*name).to_str().unwrap().to_string()
+        }).collect())
+    };
+    let filter = if options.filter.is_null() {
+        None
+    } else {
+        Some(unsafe { CStr::from_ptr(options.filter) }.to_str().unwrap().to_string())
+    };
+    SearchOptions {
+        limit: Some(options.limit).filter(|limit| *limit != 0),
+        nprobes: Some(options.nprobes).filter(|nprobes| *nprobes != 0),
+        refine_factor: Some(options.refine_factor).filter(|factor| *factor != 0),
+        distance_type: options.distance_type.to_distance_type(),
+        select_columns,
+        filter,
+        postfilter: options.postfilter != 0,
+    }
+}
+
+/// Runs a nearest neighbor search of `query` against the vector column `column_name`.
+async fn search_table(
+    table: &lancedb::Table,
+    column_name: &str,
+    query_vector: QueryVector<'_>,
+    options: &SearchOptions,
+) -> lancedb::Result<Vec<RecordBatch>> {
     use futures_util::TryStreamExt;
+
+    let mut query = table
+        .query();
+    if let Some(limit) = options.limit {
+        query = query.limit(limit);
+    }
+    if let Some(columns) = &options.select_columns {
+        query = query.select(Select::Columns(columns.clone()));
+    }
+    if let Some(filter) = &options.filter {
+        query = query.only_if(filter.clone());
+    }
+
+    let results = match query_vector {
+        QueryVector::Float16(data) => query.nearest_to(data),
+        QueryVector::Float32(data) => {
+            // println!("f32 data: {:?}", data);
+            query.nearest_to(data)
+        },
+        QueryVector::Float64(data) => {
+            // println!("f64 data: {:?}", data);
+            query.nearest_to(data)
+        },
+    };
+
+    let mut query = results?
+        .column(column_name)
+        .distance_type(options.distance_type);
+    if let Some(nprobes) = options.nprobes {
+        query = query.nprobes(nprobes);
+    }
+    if let Some(refine_factor) = options.refine_factor {
+        query = query.refine_factor(refine_factor);
+    }
+    if options.postfilter {
+        query = query.postfilter();
+    }
+
+    query
+        .execute()
+        .await?
+        .try_collect::<Vec<_>>()
+        .await
+}
+
+/// Copies a result batch into heap memory owned by the caller, which is released
+/// by `lancedb_free_search_results`.
+fn record_batch_to_c_data(result: &RecordBatch) -> lancedb_data_t {
+    use std::slice;
+
+    let schema = result.schema();
+    /*
+    schema: Schema {
+        fields: [
+            Field { name: "id", data_type: Int32, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
+            Field { name: "name", data_type: Int32, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
+            Field { name: "vector", data_type: FixedSizeList(Field { name: "item", data_type: Float32, nullable: true, dict_id: 0, dict_is_ordered: false, metadata: {} }, 512), nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
+            Field { name: "time", data_type: Timestamp(Millisecond, None), nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
+            Field { name: "comment", data_type: Binary, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
+            Field { name: "binary", data_type: Binary, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
+            Field { name: "_distance", data_type: Float32, nullable: true, dict_id: 0, dict_is_ordered: false, metadata: {} }
+        ]
+     }
+    */
+    let mut field_data_vec: Vec<lancedb_field_data_t> = Vec::new();
+    let fiels_data_count = schema.fields().len();
+
+    for (index, field) in schema.fields().iter().enumerate() {
+        // println!("field: {:?}", field);
+
+        let mut field_data_type = field.data_type();
+        let mut field_type = lancedb_field_type_t::LanceDBFieldTypeScalar;
+        let mut dimension :usize = 1;
+        let field_name = field.name();
+        // println!(">> name: {:?}", field_name);
+        // println!("    data_type: {:?}", field_data_type);
+        // let mut inner_field: &FieldRef = field;
+
+        match field.data_type() {
+            FixedSizeList(inner_type, dim) => {
+                field_type = lancedb_field_type_t::LanceDBFieldTypeVector;
+                field_data_type = inner_type.data_type();
+                // println!("    inner field_data_type: {:?}", field_data_type);
+                dimension = *dim as usize;
+                // inner_field = inner_type;
+            },
+            _ => { /* do nothing */ }
+        };
+
+        let column_data = result.column(index);
+        let data_count = column_data.len();
+
+        // println!("    field_type: {:?}", field_type);
+        // println!("    dimension: {:?}", dimension);
+        // println!("    data_count: {:?}", data_count);
+        // println!("    column_data: {:?}", column_data);
+        // println!("    inner_field: {:?}", inner_field);
+
+        let data_ptr : *mut c_void;
+        let mut offsets_ptr : *mut usize = null_mut();
+
+        // macro_rules! heap_malloc {
+        //     ($alloc_sz:expr) => {
+        //         Box::into_raw(vec![0 as i8; $alloc_sz].into_boxed_slice()) as *mut c_void
+        //     };
+        // }
+
+        macro_rules! create_array_data_scalar {
+            ($array_type:ty, $rust_type:ty) => {
+                let alloc_sz = data_count * dimension * mem::size_of::<$rust_type>();
+                // at least one byte even without rows, the buffer is released with free()
+                let data = Box::into_raw(vec![0 as i8; std::cmp::max(alloc_sz, 1)].into_boxed_slice()) as *mut c_void;
+                data_ptr = data;
+                // println!("allocated memory {} bytes", alloc_sz);
+                assert_eq!(dimension, 1);
+                let array = column_data.as_any().downcast_ref::<$array_type>().unwrap();
+                let mut vec = Vec::new();
+                for i in 0..array.len() {
+                    let value = array.value(i);
+                    vec.push(value);
+                }
+                let raw_data = data as *mut $rust_type;
+                let rust_data = unsafe {
+                    assert!(!raw_data.is_null());
+                    slice::from_raw_parts_mut(raw_data, data_count as usize)
+                };
+                rust_data.copy_from_slice(&vec);
+            };
+        }
+
+        macro_rules! create_array_data_vector {
+            ($array_type:ty, $rust_type:ty) => {
+                // alloc memory in heap with size of data_count * dimension * size_of(i8)
+                let alloc_sz = data_count * dimension * mem::size_of::<$rust_type>();
+                // at least one byte even without rows, the buffer is released with free()
+                let data = Box::into_raw(vec![0 as i8; std::cmp::max(alloc_sz, 1)].into_boxed_slice()) as *mut c_void;
+                // println!("allocated memory {} bytes", alloc_sz);
+                data_ptr = data;
+                // copy data to data with dimension * data_count
+                let fs_lst = column_data.as_fixed_size_list();
+                // println!("fs_lst: {:?}", fs_lst);
+                let mut vec :Vec<$rust_type> = Vec::new();
+                for i in 0..fs_lst.len() {
+                    let value_array = fs_lst.value(i);
+                    if let Some(st_array) = value_array.as_any().downcast_ref::<$array_type>() {
+                        for _j in 0..dimension {
+                            vec.push(st_array.value(_j));
+                        }
+                    } else {
+                        panic!("Not a/an {} array", stringify!($array_type));
+                    }
+
+                }
+                let raw_data = data as *mut $rust_type;
+                let rust_data = unsafe {
+                    assert!(!raw_data.is_null());
+                    std::slice::from_raw_parts_mut(raw_data, data_count as usize * dimension)
+                };
+                rust_data.copy_from_slice(&vec);
+            };
+        }
+
+        macro_rules! create_array_data {
+            ($array_type:ty, $rust_type:ty) => {
+                match field_type {
+                    lancedb_field_type_t::LanceDBFieldTypeScalar => {
+                        create_array_data_scalar!($array_type, $rust_type);
+                    },
+                    lancedb_field_type_t::LanceDBFieldTypeVector => {
+                        create_array_data_vector!($array_type, $rust_type);
+                    }
+                }
+            };
+        }
+
+        let data_type = match field_data_type {
+            DataType::Int8 => {
+                create_array_data!(Int8Array, i8);
+                lancedb_field_data_type_t::LanceDBFieldTypeInt8
+            },
+            DataType::Int16 => {
+                create_array_data!(Int16Array, i16);
+                lancedb_field_data_type_t::LanceDBFieldTypeInt16
+            },
+            DataType::Int32 => {
+                create_array_data!(Int32Array, i32);
+                lancedb_field_data_type_t::LanceDBFieldTypeInt32
+            },
+            DataType::Int64 => {
+                create_array_data!(Int64Array, i64);
+                lancedb_field_data_type_t::LanceDBFieldTypeInt64
+            },
+            DataType::UInt8 => {
+                create_array_data!(UInt8Array, u8);
+                lancedb_field_data_type_t::LanceDBFieldTypeUInt8
+            },
+            DataType::UInt16 => {
+                create_array_data!(UInt16Array, u16);
+                lancedb_field_data_type_t::LanceDBFieldTypeUInt16
+            },
+            DataType::UInt32 => {
+                create_array_data!(UInt32Array, u32);
+                lancedb_field_data_type_t::LanceDBFieldTypeUInt32
+            },
+            DataType::UInt64 => {
+                create_array_data!(UInt64Array, u64);
+                lancedb_field_data_type_t::LanceDBFieldTypeUInt64
+            },
+            DataType::Float16 => {
+                create_array_data!(Float16Array, <Float16Type as ArrowPrimitiveType>::Native);
+                lancedb_field_data_type_t::LanceDBFieldTypeFloat16
+            },
+            DataType::Float32 => {
+                create_array_data!(Float32Array, f32);
+                lancedb_field_data_type_t::LanceDBFieldTypeFloat32
+            },
+            DataType::Float64 => {
+                create_array_data!(Float64Array, f64);
+                lancedb_field_data_type_t::LanceDBFieldTypeFloat64
+            },
+            DataType::Binary => {
+                match field_type {
+                    lancedb_field_type_t::LanceDBFieldTypeScalar => {
+                        (data_ptr, offsets_ptr) = byte_array_to_contiguous(column_data.as_binary::<i32>());
+                    },
+                    lancedb_field_type_t::LanceDBFieldTypeVector => {
+                        panic!("Unsupported data type: Vec<Binary>");
+                    }
+                }
+                lancedb_field_data_type_t::LanceDBFieldTypeBlob
+            },
+            DataType::Timestamp(_, _) => {
+                create_array_data!(TimestampMillisecondArray, i64);
+                lancedb_field_data_type_t::LanceDBFieldTypeTimestamp
+            },
+            DataType::Utf8 => {
+                match field_type {
+                    lancedb_field_type_t::LanceDBFieldTypeScalar => {
+                        (data_ptr, offsets_ptr) = byte_array_to_contiguous(column_data.as_string::<i32>());
+                    },
+                    lancedb_field_type_t::LanceDBFieldTypeVector => {
+                        panic!("Unsupported data type: Vec<Binary>");
+                    }
+                }
+                lancedb_field_data_type_t::LanceDBFieldTypeString
+            },
+            _ => { panic!("Unsupported data type"); }
+        };
+
+        // Create field data info
+        let field_data : lancedb_field_data_t = lancedb_field_data_t {
+            name: string_to_c_char_ptr(field_name.to_string()),
+            data_type: data_type,
+            field_type: field_type,
+            data_count: data_count,
+            dimension: dimension,
+            data: data_ptr,
+            binary_size: null_mut(),
+            offsets: offsets_ptr,
+        };
+
+        // println!("name: {:?}, data_type: {:?}, field_type: {:?}, data_count: {:?}, dimension: {:?}, data: {:?}, binary_size: {:?}",
+        //          field_data.name, field_data.data_type, field_data.field_type, field_data.data_count, field_data.dimension, field_data.data, field_data.binary_size);
+        field_data_vec.push(field_data);
+    }
+
+
+    // no fields is returned as a null pointer, as an empty boxed slice is not a malloc'ed one
+    let field_data_heap = if field_data_vec.is_empty() {
+        null_mut()
+    } else {
+        Box::into_raw(field_data_vec.into_boxed_slice()) as *mut lancedb_field_data_t
+    };
+    // println!("field_data_heap: {:?}", field_data_heap);
+
+    lancedb_data_t {
+        fields: field_data_heap,
+        num_fields: fiels_data_count,
+    }
+}
+
+/// Searches the vector column `column_index` of an opened table, and converts the first
+/// result batch to its C representation. Returns None if the search failed.
+async fn search_opened_table(
+    table: &lancedb::Table,
+    schema: &Schema,
+    column_index: usize,
+    data: SendPtr,
+    dimension: i32,
+    options: &SearchOptions,
+) -> Option<lancedb_data_t> {
+    let field = schema.field(column_index);
+    let query = query_vector(field, data, dimension)?;
+
+    let results = match search_table(table, field.name(), query, options).await {
+        Ok(results) => results,
+        Err(e) => {
+            eprintln!("Failed to search: {}", e);
+            return None;
+        }
+    };
+
+    // a limit, a filter or several fragments can spread the rows over several batches
+    let result = match results.first() {
+        Some(first) => match concat_batches(&first.schema(), &results) {
+            Ok(result) => result,
+            Err(e) => {
+                eprintln!("Failed to concatenate search results: {}", e);
+                return None;
+            }
+        },
+        None => return Some(lancedb_data_t { fields: null_mut(), num_fields: 0 }),
+    };
+    Some(record_batch_to_c_data(&result))
+}
+
+/// Searches an opened table and writes all the result rows to `search_results`.
+fn search_into_results(
+    rt: &Runtime,
+    table: &lancedb::Table,
+    schema: &Schema,
+    column_index: usize,
+    data: *const c_void,
+    dimension: i32,
+    options: &SearchOptions,
+    search_results: *mut lancedb_data_t,
+) -> bool {
+    unsafe {
+        assert!(!search_results.is_null());
+        *search_results = lancedb_data_t { fields: null_mut(), num_fields: 0 };
+    }
+
+    let data = SendPtr(data as *mut c_void);
+    match rt.block_on(search_opened_table(table, schema, column_index, data, dimension, options)) {
+        Some(results) => {
+            unsafe {
+                *search_results = results;
+            }
+            true
+        }
+        None => false,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_search(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    search_results: *mut lancedb_data_t,
+) -> bool {
+    lancedb_search_with_options(connection_ptr, table_name, column_name, data, dimension,
+                                std::ptr::null(), search_results)
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_search_with_options(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    options: *const lancedb_search_options_t,
+    search_results: *mut lancedb_data_t,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let column_name = unsafe {
+        assert!(!column_name.is_null());
+        CStr::from_ptr(column_name).to_str().unwrap()
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
     // Perform the query
-    let rt = Runtime::new().unwrap();
-    let result = rt.block_on(async {
-        let table = connection.open_table(table_name).execute().await;
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+
+    // find the column matches column name
+    let column_index = match schema.index_of(column_name) {
+        Ok(index) => index,
+        Err(_) => {
+            eprintln!("Failed to find column: {}", column_name);
+            return false;
+        }
+    };
+
+    let options = c_search_options(options);
+    search_into_results(rt, &table, &schema, column_index, data, dimension, &options, search_results)
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_search_batch(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    column_name: *const c_char,
+    queries: *const c_void,
+    num_queries: usize,
+    dimension: i32,
+    options: *const lancedb_search_options_t,
+    search_results: *mut lancedb_data_t,
+) -> bool {
+    use futures_util::future::join_all;
+    use std::slice;
+
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let column_name = unsafe {
+        assert!(!column_name.is_null());
+        CStr::from_ptr(column_name).to_str().unwrap()
+    };
+    let results = unsafe {
+        assert!(!search_results.is_null() || num_queries == 0);
+        if num_queries == 0 {
+            return true;
+        }
+        slice::from_raw_parts_mut(search_results, num_queries)
+    };
+    for result in results.iter_mut() {
+        *result = lancedb_data_t { fields: null_mut(), num_fields: 0 };
+    }
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+    let rt = handle.runtime();
+
+    // The table is opened once for all the queries
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return false,
+    };
+    let column_index = match schema.index_of(column_name) {
+        Ok(index) => index,
+        Err(_) => {
+            eprintln!("Failed to find column: {}", column_name);
+            return false;
+        }
+    };
+    let element_size = match vector_element_type(schema.field(column_index)) {
+        Some(data_type) if data_type.is_floating() => data_type.primitive_width().unwrap(),
+        _ => {
+            eprintln!("Not a float vector field: {}", column_name);
+            return false;
+        }
+    };
+    assert!(!queries.is_null());
+
+    // Each query is a task of its own, so that the queries run in parallel on the worker
+    // threads. The caller memory outlives them, as all of them are waited for.
+    let options = Arc::new(c_search_options(options));
+    let tasks = results.iter_mut().enumerate().map(|(i, result)| {
+        let data = SendPtr(unsafe {
+            (queries as *const u8).add(i * dimension as usize * element_size) as *mut c_void
+        });
+        let result = SendPtr(result as *mut lancedb_data_t as *mut c_void);
+        let table = table.clone();
+        let schema = schema.clone();
+        let options = options.clone();
+        rt.spawn(async move {
+            match search_opened_table(&table, &schema, column_index, data, dimension, &options).await {
+                Some(search_result) => {
+                    unsafe {
+                        *(result.0 as *mut lancedb_data_t) = search_result;
+                    }
+                    true
+                }
+                None => false,
+            }
+        })
+    }).collect::<Vec<_>>();
+
+    rt.block_on(join_all(tasks))
+        .into_iter()
+        .fold(true, |success, task| success & task.unwrap_or(false))
+}
+
+/// Object behind a `lancedb_table_handle_t`. The schema and the column indexes are
+/// resolved once when the table is opened instead of on every insert and search.
+/// It keeps its own reference to the connection, so table calls need no registry lookup.
+struct LanceDBTable {
+    handle: Arc<LanceDBConnection>,
+    table: lancedb::Table,
+    schema: SchemaRef,
+    column_indexes: HashMap<String, usize>,
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_open_table(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+) -> *mut c_void {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return null_mut();
+        }
+    };
+    let rt = handle.runtime();
+
+    let (table, schema) = match rt.block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return null_mut(),
+    };
+
+    let column_indexes = schema.fields().iter().enumerate()
+        .map(|(index, field)| (field.name().clone(), index))
+        .collect();
+
+    let table_box = Box::new(LanceDBTable {
+        handle: handle.clone(),
+        table,
+        schema,
+        column_indexes,
+    });
+    Box::into_raw(table_box) as *mut c_void
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_table_close(table_ptr: *mut c_void) -> bool {
+    if table_ptr.is_null() {
+        return false;
+    }
+    unsafe {
+        let _ = Box::from_raw(table_ptr as *mut LanceDBTable);
+    }
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_table_insert(
+    table_ptr: *mut c_void,
+    field_data: *mut lancedb_data_t,
+) -> bool {
+    let table = unsafe {
+        assert!(!table_ptr.is_null());
+        &*(table_ptr as *const LanceDBTable)
+    };
+
+    insert_into_table(table.handle.runtime(), &table.table, table.schema.clone(), field_data)
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_table_search(
+    table_ptr: *mut c_void,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    search_results: *mut lancedb_data_t,
+) -> bool {
+    lancedb_table_search_with_options(table_ptr, column_name, data, dimension,
+                                      std::ptr::null(), search_results)
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_table_search_with_options(
+    table_ptr: *mut c_void,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    options: *const lancedb_search_options_t,
+    search_results: *mut lancedb_data_t,
+) -> bool {
+    let table = unsafe {
+        assert!(!table_ptr.is_null());
+        &*(table_ptr as *const LanceDBTable)
+    };
+    let column_name = unsafe {
+        assert!(!column_name.is_null());
+        CStr::from_ptr(column_name).to_str().unwrap()
+    };
+
+    let column_index = match table.column_indexes.get(column_name) {
+        Some(index) => *index,
+        None => {
+            eprintln!("Failed to find column: {}", column_name);
+            return false;
+        }
+    };
+
+    let options = c_search_options(options);
+    search_into_results(table.handle.runtime(), &table.table, &table.schema, column_index,
+                        data, dimension, &options, search_results)
+}
+
+/// Completion callbacks of the asynchronous API.
+type lancedb_search_callback_t = Option<unsafe extern "C" fn(*mut c_void, bool, *mut lancedb_data_t)>;
+type lancedb_insert_callback_t = Option<unsafe extern "C" fn(*mut c_void, bool)>;
+
+/// Hands the search results over to a completion callback, which takes ownership of them.
+/// Converts a string argument of an asynchronous call up front, so that a bad argument makes
+/// the call return false instead of panicking in the task, where the callback would be lost.
+fn c_str_arg(s: *const c_char, what: &str) -> Option<String> {
+    if s.is_null() {
+        eprintln!("Invalid {}: null", what);
+        return None;
+    }
+    match unsafe { CStr::from_ptr(s) }.to_str() {
+        Ok(s) => Some(s.to_string()),
+        Err(e) => {
+            eprintln!("Invalid {}: {}", what, e);
+            None
+        }
+    }
+}
+
+/// Runs the work of an asynchronous call, a panic in it counts as a failure so that the
+/// callback is still called exactly once.
+async fn catch_task_panic<T, F: std::future::Future<Output = T>>(task: F, failure: T) -> T {
+    use futures_util::FutureExt;
+    use std::panic::AssertUnwindSafe;
+
+    match AssertUnwindSafe(task).catch_unwind().await {
+        Ok(result) => result,
+        Err(_) => {
+            eprintln!("Asynchronous call panicked");
+            failure
+        }
+    }
+}
+
+fn complete_search(
+    callback: unsafe extern "C" fn(*mut c_void, bool, *mut lancedb_data_t),
+    user_data: SendPtr,
+    results: Option<lancedb_data_t>,
+) {
+    let success = results.is_some();
+    let mut results = results.unwrap_or(lancedb_data_t { fields: null_mut(), num_fields: 0 });
+    unsafe {
+        callback(user_data.0, success, &mut results);
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_search_async(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    callback: lancedb_search_callback_t,
+    user_data: *mut c_void,
+) -> bool {
+    lancedb_search_async_with_options(connection_ptr, table_name, column_name, data, dimension,
+                                      std::ptr::null(), callback, user_data)
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_search_async_with_options(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    options: *const lancedb_search_options_t,
+    callback: lancedb_search_callback_t,
+    user_data: *mut c_void,
+) -> bool {
+    // Convert C types to Rust types
+    let (table_name, column_name) = match (c_str_arg(table_name, "table name"), c_str_arg(column_name, "column name")) {
+        (Some(table_name), Some(column_name)) => (table_name, column_name),
+        _ => return false,
+    };
+    if data.is_null() || dimension <= 0 {
+        eprintln!("Invalid query vector");
+        return false;
+    }
+    let callback = match callback {
+        Some(callback) => callback,
+        None => return false,
+    };
 
-        let table = match table {
-            Ok(table) => table,
-            Err(e) => {
-                eprintln!("Failed to open table: {}", e);
-                return false;
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+
+    // The options are copied before returning
+    let options = c_search_options(options);
+    let data = SendPtr(data as *mut c_void);
+    let user_data = SendPtr(user_data);
+    let task_handle = handle.clone();
+    handle.runtime().spawn(async move {
+        let results = catch_task_panic(async {
+            match open_table_with_schema(&task_handle, &table_name).await {
+                Some((table, schema)) => match schema.index_of(&column_name) {
+                    Ok(column_index) => search_opened_table(&table, &schema, column_index, data, dimension,
+                                                           &options).await,
+                    Err(_) => {
+                        eprintln!("Failed to find column: {}", column_name);
+                        None
+                    }
+                },
+                None => None,
             }
-        };
+        }, None).await;
+        complete_search(callback, user_data, results);
+    });
+    true
+}
 
-        let schema = table.schema().await.unwrap();
-        // find the column matches column name
-        let mut column_index = 0xffffffff;
-        for (index, field) in schema.fields().iter().enumerate() {
-            if field.name() == column_name {
-                column_index = index;
-                break;
+#[no_mangle]
+pub extern "C" fn lancedb_insert_async(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    field_data: *mut lancedb_data_t,
+    callback: lancedb_insert_callback_t,
+    user_data: *mut c_void,
+) -> bool {
+    // Convert C types to Rust types
+    let table_name = match c_str_arg(table_name, "table name") {
+        Some(table_name) => table_name,
+        None => return false,
+    };
+    if field_data.is_null() {
+        eprintln!("Invalid field data: null");
+        return false;
+    }
+    let callback = match callback {
+        Some(callback) => callback,
+        None => return false,
+    };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return false;
+        }
+    };
+
+    // The data is copied before returning, the caller may release it right away
+    let arrays = c_data_to_arrays(field_data);
+    let user_data = SendPtr(user_data);
+    let task_handle = handle.clone();
+    handle.runtime().spawn(async move {
+        let success = catch_task_panic(async {
+            match open_table_with_schema(&task_handle, &table_name).await {
+                Some((table, schema)) => add_arrays(&table, schema, arrays).await,
+                None => false,
             }
+        }, false).await;
+        unsafe {
+            callback(user_data.0, success);
         }
-        if column_index == 0xffffffff {
+    });
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_table_search_async(
+    table_ptr: *mut c_void,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    callback: lancedb_search_callback_t,
+    user_data: *mut c_void,
+) -> bool {
+    lancedb_table_search_async_with_options(table_ptr, column_name, data, dimension, std::ptr::null(),
+                                            callback, user_data)
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_table_search_async_with_options(
+    table_ptr: *mut c_void,
+    column_name: *const c_char,
+    data: *const c_void,
+    dimension: i32,
+    options: *const lancedb_search_options_t,
+    callback: lancedb_search_callback_t,
+    user_data: *mut c_void,
+) -> bool {
+    let table = unsafe {
+        assert!(!table_ptr.is_null());
+        &*(table_ptr as *const LanceDBTable)
+    };
+    let column_name = match c_str_arg(column_name, "column name") {
+        Some(column_name) => column_name,
+        None => return false,
+    };
+    if data.is_null() || dimension <= 0 {
+        eprintln!("Invalid query vector");
+        return false;
+    }
+    let callback = match callback {
+        Some(callback) => callback,
+        None => return false,
+    };
+
+    let column_index = match table.column_indexes.get(&column_name) {
+        Some(index) => *index,
+        None => {
             eprintln!("Failed to find column: {}", column_name);
             return false;
         }
+    };
 
-        let fields = schema.fields();
-        let field = fields.get(column_index).unwrap();
-        let field_data_type = field.data_type();
-        let mut inner_type= field_data_type;
-        let field_type = match field_data_type {
-            FixedSizeList(inner_ty, dim) => {
-                inner_type = inner_ty.data_type();
-                lancedb_field_type_t::LanceDBFieldTypeVector
-            },
-            _ => {
-                lancedb_field_type_t::LanceDBFieldTypeScalar
-            }
-        };
-        if field_type == lancedb_field_type_t::LanceDBFieldTypeScalar {
-            eprintln!("Not a vector field: {}", column_name);
+    let options = c_search_options(options);
+    let data = SendPtr(data as *mut c_void);
+    let user_data = SendPtr(user_data);
+    // The task keeps the connection alive even if the table is closed meanwhile
+    let task_handle = table.handle.clone();
+    let task_table = table.table.clone();
+    let schema = table.schema.clone();
+    table.handle.runtime().spawn(async move {
+        let _connection = task_handle;
+        let results = catch_task_panic(
+            search_opened_table(&task_table, &schema, column_index, data, dimension, &options),
+            None).await;
+        complete_search(callback, user_data, results);
+    });
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_table_insert_async(
+    table_ptr: *mut c_void,
+    field_data: *mut lancedb_data_t,
+    callback: lancedb_insert_callback_t,
+    user_data: *mut c_void,
+) -> bool {
+    let table = unsafe {
+        assert!(!table_ptr.is_null());
+        &*(table_ptr as *const LanceDBTable)
+    };
+    if field_data.is_null() {
+        eprintln!("Invalid field data: null");
+        return false;
+    }
+    let callback = match callback {
+        Some(callback) => callback,
+        None => return false,
+    };
+
+    // The data is copied before returning, the caller may release it right away
+    let arrays = c_data_to_arrays(field_data);
+    let user_data = SendPtr(user_data);
+    let task_handle = table.handle.clone();
+    let task_table = table.table.clone();
+    let schema = table.schema.clone();
+    table.handle.runtime().spawn(async move {
+        let _connection = task_handle;
+        let success = catch_task_panic(add_arrays(&task_table, schema, arrays), false).await;
+        unsafe {
+            callback(user_data.0, success);
+        }
+    });
+    true
+}
+
+/// Rows buffered by an appender, waiting to be committed.
+struct AppenderBuffer {
+    batches: Vec<RecordBatch>,
+    num_rows: usize,
+    num_bytes: usize,
+    /// When the oldest buffered rows were appended.
+    since: Option<Instant>,
+}
+
+/// Object behind a `lancedb_appender_handle_t`. Appended rows are kept as record batches
+/// and written in a single `add` once a threshold is reached, so that many small appends
+/// make one table version and fragment instead of one each.
+struct LanceDBAppender {
+    shared: Arc<AppenderShared>,
+    /// Wakes the timer task up when rows are buffered, or the appender is closed.
+    wake: Arc<Notify>,
+}
+
+/// State of an appender shared with its timer task, which only holds a weak reference so
+/// that closing the appender releases the table.
+struct AppenderShared {
+    handle: Arc<LanceDBConnection>,
+    table: lancedb::Table,
+    schema: SchemaRef,
+    max_rows: usize,
+    max_bytes: usize,
+    max_interval: Option<Duration>,
+    /// Held across the commit, so that a flush returns once the rows are committed.
+    buffer: tokio::sync::Mutex<AppenderBuffer>,
+}
+
+const DEFAULT_APPENDER_MAX_ROWS: usize = 100_000;
+const DEFAULT_APPENDER_MAX_BYTES: usize = 64 << 20;
+
+impl AppenderShared {
+    fn is_expired(&self, buffer: &AppenderBuffer) -> bool {
+        match (self.max_interval, buffer.since) {
+            (Some(interval), Some(since)) => since.elapsed() >= interval,
+            _ => false,
+        }
+    }
+
+    fn is_full(&self, buffer: &AppenderBuffer) -> bool {
+        buffer.num_rows >= self.max_rows || buffer.num_bytes >= self.max_bytes || self.is_expired(buffer)
+    }
+
+    /// Commits the buffered rows. They are kept in the buffer if the commit fails.
+    async fn flush(&self, buffer: &mut AppenderBuffer) -> bool {
+        if buffer.batches.is_empty() {
+            return true;
+        }
+        let batches = buffer.batches.clone();
+        if !add_batches(&self.table, self.schema.clone(), batches).await {
             return false;
         }
+        buffer.batches.clear();
+        buffer.num_rows = 0;
+        buffer.num_bytes = 0;
+        buffer.since = None;
+        true
+    }
+}
 
-        let query = table
-            .query();
+/// Commits the rows of an appender once the oldest of them are `interval` old, even if
+/// nothing more is appended. Returns when the appender is closed.
+async fn run_appender_timer(shared: std::sync::Weak<AppenderShared>, wake: Arc<Notify>, interval: Duration) {
+    loop {
+        let due = match shared.upgrade() {
+            Some(shared) => shared.buffer.lock().await.since.map(|since| since + interval),
+            None => return,
+        };
+        match due {
+            Some(due) => tokio::time::sleep_until(tokio::time::Instant::from_std(due)).await,
+            None => wake.notified().await,
+        }
 
-        let results = match inner_type {
-            DataType::Float32 => {
-                let data = unsafe {
-                    assert!(!data.is_null());
-                    slice::from_raw_parts(data as *const f32, dimension as usize)
-                };
-                // println!("f32 data: {:?}", data);
-                query.nearest_to(data)
-            },
-            DataType::Float64 => {
-                let data = unsafe {
-                    assert!(!data.is_null());
-                    slice::from_raw_parts(data as *const f64, dimension as usize)
-                };
-                // println!("f64 data: {:?}", data);
-                query.nearest_to(data)
-            },
-            _ => {
-                panic!("Unsupported data type");
-            }
+        let shared = match shared.upgrade() {
+            Some(shared) => shared,
+            None => return,
         };
+        let mut buffer = shared.buffer.lock().await;
+        if shared.is_expired(&buffer) && !shared.flush(&mut buffer).await {
+            // kept for the next flush, tried again after another interval
+            buffer.since = Some(Instant::now());
+        }
+    }
+}
 
-        // let results = query
-        //     .nearest_to(data);
+#[no_mangle]
+pub extern "C" fn lancedb_appender_open(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    options: *const lancedb_appender_options_t,
+) -> *mut c_void {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let (max_rows, max_bytes, max_interval_ms) = match unsafe { options.as_ref() } {
+        Some(options) => (options.max_rows, options.max_bytes, options.max_interval_ms),
+        None => (0, 0, 0),
+    };
 
-        let results = results
-            .unwrap()
-            .distance_type(lancedb::DistanceType::Cosine)
-            .execute()
-            .await
-            .unwrap()
-            .try_collect::<Vec<_>>()
-            .await
-            .unwrap();
-
-        for result in &results {
-            // println!("result: {:?}", result);
-
-            let indexes_array = result.column(0);
-            let indexes_vec = convert_to_i32_vec(indexes_array).unwrap();
-            // println!("indexes: {:?}", indexes);
-            let schema = result.schema();
-            /*
-            schema: Schema {
-                fields: [
-                    Field { name: "id", data_type: Int32, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
-                    Field { name: "name", data_type: Int32, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
-                    Field { name: "vector", data_type: FixedSizeList(Field { name: "item", data_type: Float32, nullable: true, dict_id: 0, dict_is_ordered: false, metadata: {} }, 512), nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
-                    Field { name: "time", data_type: Timestamp(Millisecond, None), nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
-                    Field { name: "comment", data_type: Binary, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
-                    Field { name: "binary", data_type: Binary, nullable: false, dict_id: 0, dict_is_ordered: false, metadata: {} },
-                    Field { name: "_distance", data_type: Float32, nullable: true, dict_id: 0, dict_is_ordered: false, metadata: {} }
-                ]
-             }
-            */
-            let mut field_data_vec: Vec<lancedb_field_data_t> = Vec::new();
-            let fiels_data_count = schema.fields().len();
-
-            for (index, field) in schema.fields().iter().enumerate() {
-                // println!("field: {:?}", field);
-
-                let mut field_data_type = field.data_type();
-                let mut field_type = lancedb_field_type_t::LanceDBFieldTypeScalar;
-                let mut dimension :usize = 1;
-                let field_name = field.name();
-                // println!(">> name: {:?}", field_name);
-                // println!("    data_type: {:?}", field_data_type);
-                // let mut inner_field: &FieldRef = field;
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return null_mut();
+        }
+    };
 
-                match field.data_type() {
-                    FixedSizeList(inner_type, dim) => {
-                        field_type = lancedb_field_type_t::LanceDBFieldTypeVector;
-                        field_data_type = inner_type.data_type();
-                        // println!("    inner field_data_type: {:?}", field_data_type);
-                        dimension = *dim as usize;
-                        // inner_field = inner_type;
-                    },
-                    _ => { /* do nothing */ }
-                };
+    let (table, schema) = match handle.runtime().block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return null_mut(),
+    };
 
-                let column_data = result.column(index);
-                let data_count = column_data.len();
-
-                // println!("    field_type: {:?}", field_type);
-                // println!("    dimension: {:?}", dimension);
-                // println!("    data_count: {:?}", data_count);
-                // println!("    column_data: {:?}", column_data);
-                // println!("    inner_field: {:?}", inner_field);
-
-                let data_ptr : *mut c_void;
-                let mut binary_size_ptr : *mut usize = null_mut();
-
-                // macro_rules! heap_malloc {
-                //     ($alloc_sz:expr) => {
-                //         Box::into_raw(vec![0 as i8; $alloc_sz].into_boxed_slice()) as *mut c_void
-                //     };
-                // }
-
-                macro_rules! create_array_data_scalar {
-                    ($array_type:ty, $rust_type:ty) => {
-                        let alloc_sz = data_count * dimension * mem::size_of::<$rust_type>();
-                        let data = Box::into_raw(vec![0 as i8; alloc_sz].into_boxed_slice()) as *mut c_void;
-                        data_ptr = data;
-                        // println!("allocated memory {} bytes", alloc_sz);
-                        assert_eq!(dimension, 1);
-                        let array = column_data.as_any().downcast_ref::<$array_type>().unwrap();
-                        let mut vec = Vec::new();
-                        for i in 0..array.len() {
-                            let value = array.value(i);
-                            vec.push(value);
-                        }
-                        let raw_data = data as *mut $rust_type;
-                        let rust_data = unsafe {
-                            assert!(!raw_data.is_null());
-                            slice::from_raw_parts_mut(raw_data, data_count as usize)
-                        };
-                        rust_data.copy_from_slice(&vec);
-                    };
-                }
+    let max_interval = if max_interval_ms != 0 { Some(Duration::from_millis(max_interval_ms)) } else { None };
+    let shared = Arc::new(AppenderShared {
+        handle,
+        table,
+        schema,
+        max_rows: if max_rows != 0 { max_rows } else { DEFAULT_APPENDER_MAX_ROWS },
+        max_bytes: if max_bytes != 0 { max_bytes } else { DEFAULT_APPENDER_MAX_BYTES },
+        max_interval,
+        buffer: tokio::sync::Mutex::new(AppenderBuffer { batches: Vec::new(), num_rows: 0, num_bytes: 0, since: None }),
+    });
+    let wake = Arc::new(Notify::new());
+    if let Some(interval) = max_interval {
+        shared.handle.runtime().spawn(run_appender_timer(Arc::downgrade(&shared), wake.clone(), interval));
+    }
+    Box::into_raw(Box::new(LanceDBAppender { shared, wake })) as *mut c_void
+}
 
-                macro_rules! create_array_data_vector {
-                    ($array_type:ty, $rust_type:ty) => {
-                        // alloc memory in heap with size of data_count * dimension * size_of(i8)
-                        let alloc_sz = data_count * dimension * mem::size_of::<$rust_type>();
-                        let data = Box::into_raw(vec![0 as i8; alloc_sz].into_boxed_slice()) as *mut c_void;
-                        // println!("allocated memory {} bytes", alloc_sz);
-                        data_ptr = data;
-                        // copy data to data with dimension * data_count
-                        let fs_lst = column_data.as_fixed_size_list();
-                        // println!("fs_lst: {:?}", fs_lst);
-                        let mut vec :Vec<$rust_type> = Vec::new();
-                        for i in 0..fs_lst.len() {
-                            let value_array = fs_lst.value(i);
-                            if let Some(st_array) = value_array.as_any().downcast_ref::<$array_type>() {
-                                for _j in 0..dimension {
-                                    vec.push(st_array.value(_j));
-                                }
-                            } else {
-                                panic!("Not a/an {} array", stringify!($array_type));
-                            }
+#[no_mangle]
+pub extern "C" fn lancedb_appender_append(
+    appender_ptr: *mut c_void,
+    field_data: *mut lancedb_data_t,
+) -> bool {
+    let appender = unsafe {
+        assert!(!appender_ptr.is_null());
+        &*(appender_ptr as *const LanceDBAppender)
+    };
+    let shared = &appender.shared;
 
-                        }
-                        let raw_data = data as *mut $rust_type;
-                        let rust_data = unsafe {
-                            assert!(!raw_data.is_null());
-                            std::slice::from_raw_parts_mut(raw_data, data_count as usize * dimension)
-                        };
-                        rust_data.copy_from_slice(&vec);
-                    };
-                }
+    // Checked against the table schema now, so a bad append does not fail a later commit
+    let arrays = c_data_to_arrays(field_data);
+    let batch = match c_arrays_to_batch(shared.schema.clone(), arrays) {
+        Ok(batch) => batch,
+        Err(e) => {
+            eprintln!("Failed to create record batch: {}", e);
+            return false;
+        }
+    };
 
-                macro_rules! create_array_data {
-                    ($array_type:ty, $rust_type:ty) => {
-                        match field_type {
-                            lancedb_field_type_t::LanceDBFieldTypeScalar => {
-                                create_array_data_scalar!($array_type, $rust_type);
-                            },
-                            lancedb_field_type_t::LanceDBFieldTypeVector => {
-                                create_array_data_vector!($array_type, $rust_type);
-                            }
-                        }
-                    };
-                }
+    shared.handle.runtime().block_on(async {
+        let mut buffer = shared.buffer.lock().await;
+        buffer.num_rows += batch.num_rows();
+        buffer.num_bytes += batch.get_array_memory_size();
+        if buffer.since.is_none() {
+            buffer.since = Some(Instant::now());
+            appender.wake.notify_one();
+        }
+        buffer.batches.push(batch);
+        if shared.is_full(&buffer) {
+            return shared.flush(&mut buffer).await;
+        }
+        true
+    })
+}
 
-                let data_type = match field_data_type {
-                    DataType::Int8 => {
-                        create_array_data!(Int8Array, i8);
-                        lancedb_field_data_type_t::LanceDBFieldTypeInt8
-                    },
-                    DataType::Int16 => {
-                        create_array_data!(Int16Array, i16);
-                        lancedb_field_data_type_t::LanceDBFieldTypeInt16
-                    },
-                    DataType::Int32 => {
-                        create_array_data!(Int32Array, i32);
-                        lancedb_field_data_type_t::LanceDBFieldTypeInt32
-                    },
-                    DataType::Int64 => {
-                        create_array_data!(Int64Array, i64);
-                        lancedb_field_data_type_t::LanceDBFieldTypeInt64
-                    },
-                    DataType::UInt8 => {
-                        create_array_data!(UInt8Array, u8);
-                        lancedb_field_data_type_t::LanceDBFieldTypeUInt8
-                    },
-                    DataType::UInt16 => {
-                        create_array_data!(UInt16Array, u16);
-                        lancedb_field_data_type_t::LanceDBFieldTypeUInt16
-                    },
-                    DataType::UInt32 => {
-                        create_array_data!(UInt32Array, u32);
-                        lancedb_field_data_type_t::LanceDBFieldTypeUInt32
-                    },
-                    DataType::UInt64 => {
-                        create_array_data!(UInt64Array, u64);
-                        lancedb_field_data_type_t::LanceDBFieldTypeUInt64
-                    },
-                    DataType::Float16 => {
-                        create_array_data!(Float16Array, <Float16Type as ArrowPrimitiveType>::Native);
-                        lancedb_field_data_type_t::LanceDBFieldTypeFloat16
-                    },
-                    DataType::Float32 => {
-                        create_array_data!(Float32Array, f32);
-                        lancedb_field_data_type_t::LanceDBFieldTypeFloat32
-                    },
-                    DataType::Float64 => {
-                        create_array_data!(Float64Array, f64);
-                        lancedb_field_data_type_t::LanceDBFieldTypeFloat64
-                    },
-                    DataType::Binary => {
-                        match field_type {
-                            lancedb_field_type_t::LanceDBFieldTypeScalar => {
-                                let fs_lst = column_data.as_binary::<i32>();
-                                let binary_len : Vec<usize> = fs_lst.iter().map(|x| x.unwrap().len()).collect();
-                                // println!("binary_len: {:?}", binary_len);
-                                binary_size_ptr = Box::into_raw(binary_len.into_boxed_slice()) as *mut usize;
-                                // println!("fs_lst: {:?}", fs_lst);
-                                let mut binary_vec :Vec<*const c_char> = Vec::new();
-                                for i in 0..fs_lst.len() {
-                                    let mut single_data: Vec<u8> = Vec::new();
-                                    let value_array = fs_lst.value(i);
-                                    for _j in 0..value_array.len() {
-                                        single_data.push(value_array[_j]);
-                                    }
-                                    // println!("single_data: {:?}", single_data);
-                                    let raw_data = Box::into_raw(single_data.into_boxed_slice()) as *const u8;
-                                    binary_vec.push(raw_data as *const c_char);
-                                }
-                                let binary_vector_c = Box::into_raw(binary_vec.into_boxed_slice()) as *mut *const c_char;
-                                data_ptr = binary_vector_c as *mut c_void;
-                            },
-                            lancedb_field_type_t::LanceDBFieldTypeVector => {
-                                panic!("Unsupported data type: Vec<Binary>");
-                            }
-                        }
-                        lancedb_field_data_type_t::LanceDBFieldTypeBlob
-                    },
-                    DataType::Timestamp(_, _) => {
-                        create_array_data!(TimestampMillisecondArray, i64);
-                        lancedb_field_data_type_t::LanceDBFieldTypeTimestamp
-                    },
-                    DataType::Utf8 => {
-                        match field_type {
-                            lancedb_field_type_t::LanceDBFieldTypeScalar => {
-                                let fs_lst = column_data.as_string::<i32>();
-                                let binary_len : Vec<usize> = fs_lst.iter().map(|x| x.unwrap().len()).collect();
-                                // println!("binary_len: {:?}", binary_len);
-                                binary_size_ptr = Box::into_raw(binary_len.into_boxed_slice()) as *mut usize;
-                                // println!("fs_lst: {:?}", fs_lst);
-                                let mut binary_vec :Vec<*const c_char> = Vec::new();
-                                for i in 0..fs_lst.len() {
-                                    let single_data = fs_lst.value(i).to_string();
-                                    // println!("single_data: {:?}", single_data);
-                                    let raw_data = string_to_c_char_ptr(single_data);
-                                    binary_vec.push(raw_data as *const c_char);
-                                }
-                                let binary_vector_c = Box::into_raw(binary_vec.into_boxed_slice()) as *mut *const c_char;
-                                data_ptr = binary_vector_c as *mut c_void;
-                            },
-                            lancedb_field_type_t::LanceDBFieldTypeVector => {
-                                panic!("Unsupported data type: Vec<Binary>");
-                            }
-                        }
-                        lancedb_field_data_type_t::LanceDBFieldTypeString
-                    },
-                    _ => { panic!("Unsupported data type"); }
-                };
+#[no_mangle]
+pub extern "C" fn lancedb_appender_flush(appender_ptr: *mut c_void) -> bool {
+    let appender = unsafe {
+        assert!(!appender_ptr.is_null());
+        &*(appender_ptr as *const LanceDBAppender)
+    };
+    let shared = &appender.shared;
 
-                // Create field data info
-                let field_data : lancedb_field_data_t = lancedb_field_data_t {
-                    name: string_to_c_char_ptr(field_name.to_string()),
-                    data_type: data_type,
-                    field_type: field_type,
-                    data_count: data_count,
-                    dimension: dimension,
-                    data: data_ptr,
-                    binary_size: binary_size_ptr, // TODO: assign binary size
-                };
+    shared.handle.runtime().block_on(async {
+        let mut buffer = shared.buffer.lock().await;
+        shared.flush(&mut buffer).await
+    })
+}
 
-                // println!("name: {:?}, data_type: {:?}, field_type: {:?}, data_count: {:?}, dimension: {:?}, data: {:?}, binary_size: {:?}",
-                //          field_data.name, field_data.data_type, field_data.field_type, field_data.data_count, field_data.dimension, field_data.data, field_data.binary_size);
-                field_data_vec.push(field_data);
-            }
+#[no_mangle]
+pub extern "C" fn lancedb_appender_close(appender_ptr: *mut c_void) -> bool {
+    if appender_ptr.is_null() {
+        return false;
+    }
+    let appender = unsafe { Box::from_raw(appender_ptr as *mut LanceDBAppender) };
+    let shared = &appender.shared;
 
+    let result = shared.handle.runtime().block_on(async {
+        let mut buffer = shared.buffer.lock().await;
+        shared.flush(&mut buffer).await
+    });
+    // the timer task stops once the appender is gone
+    appender.wake.notify_one();
+    result
+}
 
-            let field_data_heap =
-                Box::into_raw(field_data_vec.into_boxed_slice()) as *mut lancedb_field_data_t;
-            // println!("field_data_heap: {:?}", field_data_heap);
+/// Message from the writers to the flusher task of a write buffer.
+enum WriteMessage {
+    /// Rows to commit, with the sender of the commit result in the committed durability.
+    Rows(RecordBatch, Option<oneshot::Sender<bool>>),
+    /// Commit the pending rows now, and send the result.
+    Flush(oneshot::Sender<bool>),
+}
 
-            let rust_lance_data: lancedb_data_t = lancedb_data_t {
-                fields: field_data_heap,
-                num_fields: fiels_data_count,
-            };
+/// State of a write buffer shared by the writers and the flusher task.
+struct WriteBufferShared {
+    stats: Mutex<lancedb_write_buffer_stats_t>,
+    /// Set when a commit fails, cleared by a flush, which reports it.
+    failed: AtomicBool,
+}
 
-            // Assign to search_results as output
-            unsafe {
-                assert!(!search_results.is_null());
-                *search_results = rust_lance_data;
+/// Object behind a `lancedb_write_buffer_handle_t`. Writers convert their rows into a record
+/// batch and queue it on an unbounded channel, so a write never waits for another one. A
+/// single flusher task on the connection runtime gathers what is queued for an interval and
+/// commits it as one table version.
+struct LanceDBWriteBuffer {
+    handle: Arc<LanceDBConnection>,
+    schema: SchemaRef,
+    durability: lancedb_durability_t,
+    sender: mpsc::UnboundedSender<WriteMessage>,
+    flusher: tokio::task::JoinHandle<()>,
+    shared: Arc<WriteBufferShared>,
+}
+
+const DEFAULT_WRITE_BUFFER_FLUSH_INTERVAL_MS: u64 = 100;
+const DEFAULT_WRITE_BUFFER_MAX_ROWS: usize = 100_000;
+
+/// Commits the pending rows in a single version, updates the statistics and sends the
+/// result to the writers waiting for it. Failed rows are dropped.
+async fn commit_write_buffer(
+    table: &lancedb::Table,
+    schema: &SchemaRef,
+    shared: &WriteBufferShared,
+    batches: &mut Vec<RecordBatch>,
+    waiters: &mut Vec<oneshot::Sender<bool>>,
+) -> bool {
+    if batches.is_empty() {
+        return true;
+    }
+    let num_rows = batches.iter().map(|batch| batch.num_rows() as u64).sum::<u64>();
+    let result = add_batches(table, schema.clone(), mem::take(batches)).await;
+    {
+        let mut stats = shared.stats.lock().unwrap();
+        stats.pending_rows -= num_rows;
+        if result {
+            stats.num_commits += 1;
+            stats.num_committed_rows += num_rows;
+            stats.min_commit_rows = if stats.num_commits == 1 { num_rows } else { stats.min_commit_rows.min(num_rows) };
+            stats.max_commit_rows = stats.max_commit_rows.max(num_rows);
+            stats.last_commit_rows = num_rows;
+        } else {
+            stats.num_failed_commits += 1;
+        }
+    }
+    if !result {
+        shared.failed.store(true, Ordering::SeqCst);
+    }
+    for waiter in waiters.drain(..) {
+        let _ = waiter.send(result);
+    }
+    result
+}
+
+/// Flusher task of a write buffer. It waits for the first queued rows, gathers everything
+/// queued until the interval is over or `max_rows` are pending, and commits it. It ends once
+/// the write buffer is closed and the queue is drained.
+async fn run_write_buffer(
+    table: lancedb::Table,
+    schema: SchemaRef,
+    shared: Arc<WriteBufferShared>,
+    mut receiver: mpsc::UnboundedReceiver<WriteMessage>,
+    flush_interval: Duration,
+    max_rows: usize,
+) {
+    let mut batches: Vec<RecordBatch> = Vec::new();
+    let mut waiters: Vec<oneshot::Sender<bool>> = Vec::new();
+    let mut closed = false;
+    while !closed {
+        let mut num_rows = 0;
+        let mut flushes: Vec<oneshot::Sender<bool>> = Vec::new();
+        let mut message = receiver.recv().await;
+        let deadline = tokio::time::Instant::now() + flush_interval;
+        loop {
+            match message {
+                Some(WriteMessage::Rows(batch, waiter)) => {
+                    num_rows += batch.num_rows();
+                    batches.push(batch);
+                    waiters.extend(waiter);
+                }
+                Some(WriteMessage::Flush(flush)) => flushes.push(flush),
+                None => closed = true,
+            }
+            if closed || !flushes.is_empty() || num_rows >= max_rows {
+                break;
             }
+            message = match tokio::time::timeout_at(deadline, receiver.recv()).await {
+                Ok(message) => message,
+                Err(_) => break,
+            };
+        }
 
-            break; // consider multiple vector search
+        let result = commit_write_buffer(&table, &schema, &shared, &mut batches, &mut waiters).await;
+        for flush in flushes {
+            // a flush also reports the failures of the commits before it, and clears them
+            let failed = shared.failed.swap(false, Ordering::SeqCst);
+            let _ = flush.send(result && !failed);
         }
+    }
+}
 
-        return true;
+/// Waiting for the flusher blocks the calling thread, which must not be a runtime thread
+/// (e.g. in a callback of an asynchronous call): blocking there would panic.
+fn can_block_on_runtime() -> bool {
+    if tokio::runtime::Handle::try_current().is_ok() {
+        eprintln!("Cannot wait for the write buffer on a runtime thread");
+        return false;
+    }
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_write_buffer_open(
+    connection_ptr: *mut c_void,
+    table_name: *const c_char,
+    options: *const lancedb_write_buffer_options_t,
+) -> *mut c_void {
+    // Convert C types to Rust types
+    let table_name = unsafe {
+        assert!(!table_name.is_null());
+        CStr::from_ptr(table_name).to_str().unwrap()
+    };
+    let (flush_interval_ms, max_rows, durability) = match unsafe { options.as_ref() } {
+        Some(options) => (options.flush_interval_ms, options.max_rows, options.durability),
+        None => (0, 0, lancedb_durability_t::LanceDBDurabilityEnqueued),
+    };
+    let flush_interval_ms = if flush_interval_ms != 0 { flush_interval_ms } else { DEFAULT_WRITE_BUFFER_FLUSH_INTERVAL_MS };
+    let max_rows = if max_rows != 0 { max_rows } else { DEFAULT_WRITE_BUFFER_MAX_ROWS };
+
+    // Get the connection from the registry
+    let handle = match get_connection(connection_ptr) {
+        Some(handle) => handle,
+        None => {
+            eprintln!("Invalid connection handle");
+            return null_mut();
+        }
+    };
+
+    let (table, schema) = match handle.runtime().block_on(open_table_with_schema(&handle, table_name)) {
+        Some(table) => table,
+        None => return null_mut(),
+    };
+
+    let shared = Arc::new(WriteBufferShared {
+        stats: Mutex::new(lancedb_write_buffer_stats_t::default()),
+        failed: AtomicBool::new(false),
     });
+    let (sender, receiver) = mpsc::unbounded_channel();
+    let flusher = handle.runtime().spawn(run_write_buffer(
+        table, schema.clone(), shared.clone(), receiver, Duration::from_millis(flush_interval_ms), max_rows));
+
+    let write_buffer = Box::new(LanceDBWriteBuffer { handle, schema, durability, sender, flusher, shared });
+    Box::into_raw(write_buffer) as *mut c_void
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_write_buffer_write(
+    write_buffer_ptr: *mut c_void,
+    field_data: *mut lancedb_data_t,
+) -> bool {
+    let write_buffer = unsafe {
+        assert!(!write_buffer_ptr.is_null());
+        &*(write_buffer_ptr as *const LanceDBWriteBuffer)
+    };
+    if write_buffer.durability == lancedb_durability_t::LanceDBDurabilityCommitted && !can_block_on_runtime() {
+        return false;
+    }
+
+    // Checked against the table schema now, so a bad write does not fail a whole commit
+    let arrays = c_data_to_arrays(field_data);
+    let batch = match c_arrays_to_batch(write_buffer.schema.clone(), arrays) {
+        Ok(batch) => batch,
+        Err(e) => {
+            eprintln!("Failed to create record batch: {}", e);
+            return false;
+        }
+    };
+
+    let num_rows = batch.num_rows() as u64;
+    {
+        let mut stats = write_buffer.shared.stats.lock().unwrap();
+        stats.num_writes += 1;
+        stats.pending_rows += num_rows;
+    }
+
+    let (waiter, result) = match write_buffer.durability {
+        lancedb_durability_t::LanceDBDurabilityCommitted => {
+            let (waiter, result) = oneshot::channel();
+            (Some(waiter), Some(result))
+        }
+        lancedb_durability_t::LanceDBDurabilityEnqueued => (None, None),
+    };
+    if write_buffer.sender.send(WriteMessage::Rows(batch, waiter)).is_err() {
+        eprintln!("Write buffer is closed");
+        write_buffer.shared.stats.lock().unwrap().pending_rows -= num_rows;
+        return false;
+    }
+    match result {
+        Some(result) => result.blocking_recv().unwrap_or(false),
+        None => true,
+    }
+}
 
-    return result;
+#[no_mangle]
+pub extern "C" fn lancedb_write_buffer_flush(write_buffer_ptr: *mut c_void) -> bool {
+    let write_buffer = unsafe {
+        assert!(!write_buffer_ptr.is_null());
+        &*(write_buffer_ptr as *const LanceDBWriteBuffer)
+    };
+    if !can_block_on_runtime() {
+        return false;
+    }
+
+    let (flush, result) = oneshot::channel();
+    if write_buffer.sender.send(WriteMessage::Flush(flush)).is_err() {
+        return false;
+    }
+    result.blocking_recv().unwrap_or(false)
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_write_buffer_get_stats(
+    write_buffer_ptr: *mut c_void,
+    stats: *mut lancedb_write_buffer_stats_t,
+) -> bool {
+    let write_buffer = unsafe {
+        assert!(!write_buffer_ptr.is_null());
+        &*(write_buffer_ptr as *const LanceDBWriteBuffer)
+    };
+    let stats = unsafe {
+        assert!(!stats.is_null());
+        &mut *stats
+    };
+    *stats = *write_buffer.shared.stats.lock().unwrap();
+    true
+}
+
+#[no_mangle]
+pub extern "C" fn lancedb_write_buffer_close(write_buffer_ptr: *mut c_void) -> bool {
+    if write_buffer_ptr.is_null() || !can_block_on_runtime() {
+        return false;
+    }
+    let write_buffer = unsafe { Box::from_raw(write_buffer_ptr as *mut LanceDBWriteBuffer) };
+    let LanceDBWriteBuffer { handle, sender, flusher, shared, .. } = *write_buffer;
+
+    // The flusher commits what is still queued and ends once the queue is closed
+    drop(sender);
+    if let Err(e) = handle.runtime().block_on(flusher) {
+        eprintln!("Write buffer flusher failed: {}", e);
+        return false;
+    }
+    !shared.failed.load(Ordering::SeqCst)
 }
 
 #[cfg(test)]
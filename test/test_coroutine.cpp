@@ -0,0 +1,134 @@
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "lancedb.hpp"
+
+// Built as C++20 into test_lancedb_coroutine, see CMakeLists.txt
+#if LANCEDB_HAS_COROUTINE
+
+using namespace lancedb;
+
+namespace {
+Task<int> Value(int v) {
+  co_return v;
+}
+
+Task<int> Sum(int a, int b) {
+  int x = co_await Value(a);
+  int y = co_await Value(b);
+  co_return x + y;
+}
+
+Task<> Increment(int& n) {
+  n++;
+  co_return;
+}
+
+Task<int> Fail() {
+  throw std::runtime_error("failed");
+  co_return 0;
+}
+
+Task<int> AwaitFail(bool& reached) {
+  int v = co_await Fail();
+  reached = true;
+  co_return v;
+}
+
+// Runs a query, and records the thread the coroutine is resumed on.
+Task<LanceDBError> QueryOn(LanceDB& db, const std::vector<float>& query, LanceDB::SearchResults& sr,
+                           Executor* executor, std::thread::id& resumed_on) {
+  LanceDBError err = co_await db.QueryAsync("test_table", "embedding", query, sr, executor);
+  resumed_on = std::this_thread::get_id();
+  co_return err;
+}
+}
+
+TEST(Coroutine, SyncWait) {
+  ASSERT_EQ(SyncWait(Sum(1, 2)), 3);
+  int n = 0;
+  SyncWait(Increment(n));
+  ASSERT_EQ(n, 1);
+
+  // tasks run as soon as they are created, and can be awaited later
+  Task<int> task = Value(42);
+  ASSERT_TRUE(task.IsDone());
+  ASSERT_EQ(SyncWait(task), 42);
+}
+
+TEST(Coroutine, ErrorPropagation) {
+  // the exception goes through the awaiting coroutine up to SyncWait
+  bool reached = false;
+  bool caught = false;
+  try {
+    SyncWait(AwaitFail(reached));
+  } catch (const std::runtime_error& e) {
+    caught = std::string(e.what()) == "failed";
+  }
+  ASSERT_TRUE(caught);
+  ASSERT_FALSE(reached);
+}
+
+TEST(Coroutine, Resume) {
+  system("rm -rf test_coroutine_resume.db");
+  LanceDB db("test_coroutine_resume.db");
+  std::vector<int> idx = { 0, 1, 2 };
+  std::vector<std::vector<float>> embeddings = { { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f } };
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  ASSERT_EQ(db.CreateBatchInserter(idx_data, embedding_data).CreateTable("test_table"), kLanceDBSuccess);
+
+  // without an executor, on the runtime worker thread that completed the search
+  LanceDB::SearchResults sr;
+  std::thread::id resumed_on;
+  ASSERT_EQ(SyncWait(QueryOn(db, embeddings[1], sr, nullptr, resumed_on)), kLanceDBSuccess);
+  ASSERT_NE(resumed_on, std::this_thread::get_id());
+  ASSERT_TRUE(sr.IsValid());
+  ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], 1);
+
+  // with an executor, on its thread. The results held by `sr` are freed before it is refilled.
+  ThreadPoolExecutor executor(1);
+  std::promise<std::thread::id> executor_thread;
+  executor.Post([&]() { executor_thread.set_value(std::this_thread::get_id()); });
+  std::thread::id executor_thread_id = executor_thread.get_future().get();
+  ASSERT_EQ(SyncWait(QueryOn(db, embeddings[2], sr, &executor, resumed_on)), kLanceDBSuccess);
+  ASSERT_EQ(resumed_on, executor_thread_id);
+  ASSERT_TRUE(sr.IsValid());
+  ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], 2);
+
+  // search options are passed through
+  LanceDB::SearchOptions options;
+  options.limit = 1;
+  options.filter = "idx >= 1";
+  options.select_columns = { "idx" };
+  ASSERT_EQ(SyncWait(db.QueryAsync("test_table", "embedding", embeddings[0], options, sr, &executor)),
+            kLanceDBSuccess);
+  ASSERT_TRUE(sr.IsValid());
+  ASSERT_EQ(sr.Get().fields[0].data_count, 1u);
+  ASSERT_NE(((int32_t*)sr.Get().fields[0].data)[0], 0);
+  for (size_t i = 0; i < sr.Get().num_fields; i++) {
+    ASSERT_NE(std::string(sr.Get().fields[i].name), "embedding");
+  }
+
+  // a failed search is reported by the error code, and leaves the results invalid
+  ASSERT_EQ(SyncWait(db.QueryAsync("no_such_table", "embedding", embeddings[0], sr, &executor)),
+            kLanceDBInternalError);
+  ASSERT_FALSE(sr.IsValid());
+
+  // inserts go through the same path
+  std::vector<int> more_idx = { 3 };
+  std::vector<std::vector<float>> more_embeddings = { { 1.f, 1.f, 0.f } };
+  LanceDB::FieldData more_idx_data("idx", more_idx);
+  LanceDB::FieldData more_embedding_data("embedding", more_embeddings);
+  auto inserter = db.CreateBatchInserter(more_idx_data, more_embedding_data);
+  ASSERT_EQ(SyncWait(inserter.InsertAsync("test_table", &executor)), kLanceDBSuccess);
+  ASSERT_EQ(SyncWait(QueryOn(db, more_embeddings[0], sr, &executor, resumed_on)), kLanceDBSuccess);
+  ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], 3);
+}
+
+#endif // LANCEDB_HAS_COROUTINE
@@ -1,5 +1,12 @@
 #include <cstdlib>
 #include <vector>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <string>
+#include <cstring>
 
 #include "gtest/gtest.h"
 #include "lancedb.h"
@@ -41,7 +48,7 @@ TEST(LanceDB, CAPI) {
   lancedb_close(handle);
 
   lancedb_field_data_t *id_field, *distance_field;
-  for (int i=0; i<result_data.num_fields; i++) {
+  for (size_t i=0; i<result_data.num_fields; i++) {
     if (strcmp(result_data.fields[i].name, "id") == 0) {
       id_field = &result_data.fields[i];
     } else if (strcmp(result_data.fields[i].name, "_distance") == 0) {
@@ -49,14 +56,877 @@ TEST(LanceDB, CAPI) {
     }
   }
   size_t data_count = id_field->data_count;
-  ASSERT_EQ(data_count, k);
+  ASSERT_EQ(data_count, (size_t)k);
 
-  for (int i=0; i<data_count; i++) {
-    printf("[%d] index=%d, simi=%f\n",
+  for (size_t i=0; i<data_count; i++) {
+    printf("[%zu] index=%d, simi=%f\n",
            i, ((int32_t*)id_field->data)[i],
            1 - ((float*)distance_field->data)[i]);
     ASSERT_EQ(((int32_t*)id_field->data)[i], target_indexes[i]);
   }
 
   lancedb_free_search_results(&result_data);
-}
\ No newline at end of file
+}
+
+TEST(LanceDB, TableHandle) {
+  system("rm -rf test_table_handle.db");
+  lancedb_handle_t handle = lancedb_init("test_table_handle.db");
+  ASSERT_NE(handle, nullptr);
+  int32_t dim = 16;
+  int32_t nz = 50;
+  std::vector<float> data(dim * nz);
+  for (int i=0; i<dim*nz; i++) {
+    data[i] = (float)(rand() % 1000) / 1000.f + 0.001f;
+  }
+
+  bool res = lancedb_create_table(handle, "test_table", data.data(), dim, nz);
+  ASSERT_TRUE(res);
+
+  ASSERT_EQ(lancedb_open_table(handle, "no_such_table"), nullptr);
+  lancedb_table_handle_t table = lancedb_open_table(handle, "test_table");
+  ASSERT_NE(table, nullptr);
+
+  std::vector<int32_t> ids = { 1000, 1001 };
+  lancedb_field_data_t fields[2] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 2, 1, ids.data(), nullptr, nullptr },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 2, (size_t)dim, data.data(), nullptr, nullptr },
+  };
+  lancedb_data_t insert_data = { fields, 2 };
+  ASSERT_TRUE(lancedb_table_insert(table, &insert_data));
+
+  for (int round=0; round<3; round++) {
+    lancedb_data_t result_data;
+    res = lancedb_table_search(table, "vector", data.data() + dim * 7, dim, &result_data);
+    ASSERT_TRUE(res);
+    lancedb_field_data_t* id_field = nullptr;
+    for (size_t i=0; i<result_data.num_fields; i++) {
+      if (strcmp(result_data.fields[i].name, "id") == 0) {
+        id_field = &result_data.fields[i];
+      }
+    }
+    ASSERT_NE(id_field, nullptr);
+    ASSERT_GT(id_field->data_count, 0);
+    ASSERT_EQ(((int32_t*)id_field->data)[0], 7);
+    lancedb_free_search_results(&result_data);
+  }
+
+  lancedb_data_t result_data;
+  ASSERT_FALSE(lancedb_table_search(table, "no_such_column", data.data(), dim, &result_data));
+
+  ASSERT_TRUE(lancedb_table_close(table));
+  lancedb_close(handle);
+}
+
+TEST(LanceDB, InitWithOptions) {
+  system("rm -rf test_init_options.db");
+  int cpus[] = { 0 };
+  lancedb_options_t options = {};
+  options.worker_threads = 2;
+  options.max_blocking_threads = 4;
+  options.cpu_affinity = cpus;
+  options.num_cpu_affinity = 1;
+  options.index_cache_size = 16;
+  options.metadata_cache_size = 16;
+  lancedb_handle_t handle = lancedb_init_with_options("test_init_options.db", &options);
+  ASSERT_NE(handle, nullptr);
+
+  int32_t dim = 16;
+  int32_t nz = 50;
+  std::vector<float> data(dim * nz);
+  for (int i=0; i<dim*nz; i++) {
+    data[i] = (float)(rand() % 1000) / 1000.f + 0.001f;
+  }
+  ASSERT_TRUE(lancedb_create_table(handle, "test_table", data.data(), dim, nz));
+
+  lancedb_data_t result_data;
+  ASSERT_TRUE(lancedb_search(handle, "test_table", "vector", data.data() + dim * 3, dim, &result_data));
+  ASSERT_GT(result_data.num_fields, 0);
+  lancedb_free_search_results(&result_data);
+  lancedb_close(handle);
+
+  // NULL options behave as lancedb_init
+  handle = lancedb_init_with_options("test_init_options.db", nullptr);
+  ASSERT_NE(handle, nullptr);
+  lancedb_close(handle);
+}
+
+TEST(LanceDB, ConcurrentSearch) {
+  system("rm -rf test_concurrent_1.db test_concurrent_2.db");
+  lancedb_handle_t handles[2] = {
+      lancedb_init("test_concurrent_1.db"), lancedb_init("test_concurrent_2.db") };
+  int32_t dim = 32;
+  int32_t nz = 200;
+  std::vector<float> data(dim * nz);
+  for (int i=0; i<dim*nz; i++) {
+    data[i] = (float)(rand() % 1000) / 1000.f + 0.001f;
+  }
+  for (auto handle: handles) {
+    ASSERT_NE(handle, nullptr);
+    ASSERT_TRUE(lancedb_create_table(handle, "test_table", data.data(), dim, nz));
+  }
+
+  int num_threads = 8;
+  int num_queries = 20;
+  std::vector<int> mismatches(num_threads, 0);
+  std::vector<std::thread> threads;
+  for (int t=0; t<num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      lancedb_handle_t handle = handles[t % 2];
+      for (int i=0; i<num_queries; i++) {
+        int target = (t * num_queries + i) % nz;
+        lancedb_data_t result_data;
+        if (!lancedb_search(handle, "test_table", "vector", data.data() + dim * target, dim, &result_data)) {
+          mismatches[t]++;
+          continue;
+        }
+        if (result_data.num_fields == 0 || ((int32_t*)result_data.fields[0].data)[0] != target) {
+          mismatches[t]++;
+        }
+        lancedb_free_search_results(&result_data);
+      }
+    });
+  }
+  for (auto& th: threads) {
+    th.join();
+  }
+  for (int t=0; t<num_threads; t++) {
+    ASSERT_EQ(mismatches[t], 0);
+  }
+
+  for (auto handle: handles) {
+    ASSERT_TRUE(lancedb_close(handle));
+    ASSERT_FALSE(lancedb_close(handle));
+  }
+}
+
+// More rows than fit in one result batch, from several fragments
+TEST(LanceDB, SearchLargeLimit) {
+  system("rm -rf test_large_limit.db");
+  lancedb_handle_t handle = lancedb_init("test_large_limit.db");
+  ASSERT_NE(handle, nullptr);
+  int32_t dim = 8;
+  int32_t nz = 4000;
+  int32_t num_fragments = 3;
+  std::vector<float> data((size_t)dim * nz * num_fragments);
+  for (auto& v: data) {
+    v = (float)(rand() % 1000) / 1000.f + 0.001f;
+  }
+  ASSERT_TRUE(lancedb_create_table(handle, "test_table", data.data(), dim, nz));
+  for (int32_t f=1; f<num_fragments; f++) {
+    std::vector<int32_t> ids(nz);
+    for (int32_t i=0; i<nz; i++) {
+      ids[i] = f * nz + i;
+    }
+    lancedb_field_data_t fields[2] = {
+        { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, (size_t)nz, 1, ids.data(), nullptr, nullptr },
+        { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, (size_t)nz, (size_t)dim,
+          data.data() + (size_t)dim * nz * f, nullptr, nullptr },
+    };
+    lancedb_data_t insert_data = { fields, 2 };
+    ASSERT_TRUE(lancedb_insert(handle, "test_table", &insert_data));
+  }
+
+  lancedb_search_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.limit = (size_t)nz * num_fragments;
+  options.filter = "id >= 0";
+  lancedb_data_t result_data;
+  ASSERT_TRUE(lancedb_search_with_options(handle, "test_table", "vector", data.data(), dim, &options,
+                                          &result_data));
+  std::vector<int32_t> ids;
+  for (size_t i=0; i<result_data.num_fields; i++) {
+    if (strcmp(result_data.fields[i].name, "id") == 0) {
+      int32_t* id_data = (int32_t*)result_data.fields[i].data;
+      ids.assign(id_data, id_data + result_data.fields[i].data_count);
+    }
+  }
+  lancedb_free_search_results(&result_data);
+  ASSERT_EQ(ids.size(), options.limit);
+  std::sort(ids.begin(), ids.end());
+  for (size_t i=0; i<ids.size(); i++) {
+    ASSERT_EQ(ids[i], (int32_t)i);
+  }
+  lancedb_close(handle);
+}
+
+namespace {
+struct AsyncState {
+  std::mutex mutex;
+  std::condition_variable cond;
+  int pending = 0;
+  int failures = 0;
+  std::vector<int32_t> top_ids;
+
+  void Done(bool success) {
+    std::lock_guard<std::mutex> lock(mutex);
+    failures += success ? 0 : 1;
+    pending--;
+    cond.notify_all();
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cond.wait(lock, [this]() { return pending == 0; });
+  }
+};
+
+void OnSearchDone(void* user_data, bool success, lancedb_data_t* search_results) {
+  auto* state = (AsyncState*)user_data;
+  if (success && search_results->num_fields > 0) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->top_ids.push_back(((int32_t*)search_results->fields[0].data)[0]);
+  }
+  if (success) {
+    lancedb_free_search_results(search_results);
+  }
+  state->Done(success);
+}
+
+// records the number of rows found instead of the top id
+void OnSearchCount(void* user_data, bool success, lancedb_data_t* search_results) {
+  auto* state = (AsyncState*)user_data;
+  if (success && search_results->num_fields > 0) {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->top_ids.push_back((int32_t)search_results->fields[0].data_count);
+  }
+  if (success) {
+    lancedb_free_search_results(search_results);
+  }
+  state->Done(success);
+}
+
+void OnInsertDone(void* user_data, bool success) {
+  ((AsyncState*)user_data)->Done(success);
+}
+
+// Writes to a write buffer from a search callback, which runs on a runtime thread.
+struct CallbackWrite {
+  AsyncState state;
+  lancedb_write_buffer_handle_t write_buffer;
+  lancedb_data_t* data;
+  bool written = true;
+};
+
+void OnSearchWrite(void* user_data, bool success, lancedb_data_t* search_results) {
+  auto* write = (CallbackWrite*)user_data;
+  if (success) {
+    lancedb_free_search_results(search_results);
+  }
+  write->written = lancedb_write_buffer_write(write->write_buffer, write->data);
+  write->state.Done(success);
+}
+}
+
+TEST(LanceDB, AsyncSearchAndInsert) {
+  system("rm -rf test_async.db");
+  lancedb_handle_t handle = lancedb_init("test_async.db");
+  ASSERT_NE(handle, nullptr);
+  int32_t dim = 16;
+  int32_t nz = 64;
+  std::vector<float> data(dim * nz);
+  for (int i=0; i<dim*nz; i++) {
+    data[i] = (float)(rand() % 1000) / 1000.f + 0.001f;
+  }
+  ASSERT_TRUE(lancedb_create_table(handle, "test_table", data.data(), dim, nz));
+  lancedb_table_handle_t table = lancedb_open_table(handle, "test_table");
+  ASSERT_NE(table, nullptr);
+
+  AsyncState state;
+  state.pending = 2 * nz;
+  for (int i=0; i<nz; i++) {
+    ASSERT_TRUE(lancedb_table_search_async(table, "vector", data.data() + dim * i, dim,
+                                           OnSearchDone, &state));
+    ASSERT_TRUE(lancedb_search_async(handle, "test_table", "vector", data.data() + dim * i, dim,
+                                     OnSearchDone, &state));
+  }
+  state.Wait();
+  ASSERT_EQ(state.failures, 0);
+  std::sort(state.top_ids.begin(), state.top_ids.end());
+  ASSERT_EQ(state.top_ids.size(), (size_t)(2 * nz));
+  for (int i=0; i<nz; i++) {
+    ASSERT_EQ(state.top_ids[2 * i], i);
+    ASSERT_EQ(state.top_ids[2 * i + 1], i);
+  }
+
+  // the inserted data is copied before the call returns
+  std::vector<int32_t> ids = { 1000 };
+  std::vector<float> vec(data.begin(), data.begin() + dim);
+  lancedb_field_data_t fields[2] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 1, 1, ids.data(), nullptr, nullptr },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 1, (size_t)dim, vec.data(), nullptr, nullptr },
+  };
+  lancedb_data_t insert_data = { fields, 2 };
+  state.pending = 2;
+  ASSERT_TRUE(lancedb_table_insert_async(table, &insert_data, OnInsertDone, &state));
+  ASSERT_TRUE(lancedb_insert_async(handle, "test_table", &insert_data, OnInsertDone, &state));
+  ids.clear();
+  vec.clear();
+  state.Wait();
+  ASSERT_EQ(state.failures, 0);
+
+  state.pending = 1;
+  ASSERT_TRUE(lancedb_search_async(handle, "no_such_table", "vector", data.data(), dim,
+                                   OnSearchDone, &state));
+  state.Wait();
+  ASSERT_EQ(state.failures, 1);
+
+  // search options are copied before the call returns
+  lancedb_search_options_t options;
+  memset(&options, 0, sizeof(options));
+  options.limit = 3;
+  state.top_ids.clear();
+  state.pending = 1;
+  ASSERT_TRUE(lancedb_table_search_async_with_options(table, "vector", data.data(), dim, &options,
+                                                      OnSearchCount, &state));
+  memset(&options, 0, sizeof(options));
+  state.Wait();
+  ASSERT_EQ(state.failures, 1);
+  ASSERT_EQ(state.top_ids, std::vector<int32_t>{ 3 });
+
+  // invalid arguments are refused up front, the callback is not called
+  ASSERT_FALSE(lancedb_search_async(handle, nullptr, "vector", data.data(), dim, OnSearchDone, &state));
+  ASSERT_FALSE(lancedb_search_async(handle, "test_table", "vector", nullptr, dim, OnSearchDone, &state));
+  ASSERT_FALSE(lancedb_table_search_async(table, "vector", nullptr, dim, OnSearchDone, &state));
+  ASSERT_FALSE(lancedb_insert_async(handle, "test_table", nullptr, OnInsertDone, &state));
+  ASSERT_FALSE(lancedb_table_insert_async(table, nullptr, OnInsertDone, &state));
+  ASSERT_EQ(state.failures, 1);
+
+  // a write waiting for its commit is refused on a runtime thread, and is not counted
+  lancedb_write_buffer_options_t write_options = {};
+  write_options.durability = kLanceDBDurabilityCommitted;
+  CallbackWrite write;
+  write.write_buffer = lancedb_write_buffer_open(handle, "test_table", &write_options);
+  ASSERT_NE(write.write_buffer, nullptr);
+  std::vector<int32_t> write_ids = { 2000 };
+  std::vector<float> write_vec(data.begin(), data.begin() + dim);
+  lancedb_field_data_t write_fields[2] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 1, 1, write_ids.data(), nullptr, nullptr },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 1, (size_t)dim, write_vec.data(), nullptr, nullptr },
+  };
+  lancedb_data_t write_data = { write_fields, 2 };
+  write.data = &write_data;
+  write.state.pending = 1;
+  ASSERT_TRUE(lancedb_table_search_async(table, "vector", data.data(), dim, OnSearchWrite, &write));
+  write.state.Wait();
+  ASSERT_EQ(write.state.failures, 0);
+  ASSERT_FALSE(write.written);
+  lancedb_write_buffer_stats_t write_stats;
+  ASSERT_TRUE(lancedb_write_buffer_get_stats(write.write_buffer, &write_stats));
+  ASSERT_EQ(write_stats.num_writes, 0u);
+  ASSERT_EQ(write_stats.pending_rows, 0u);
+  ASSERT_TRUE(lancedb_write_buffer_close(write.write_buffer));
+
+  lancedb_table_close(table);
+  lancedb_close(handle);
+}
+
+// Arrow C data export of an int32 "id" column and a fixed size list<float> "vector" column,
+// over buffers owned by the test. Releasing a struct only marks it (and its children) released.
+struct ArrowBatchExport {
+  ArrowBatchExport(std::vector<int32_t>& ids, std::vector<float>& vectors, int dim) {
+    vector_format = "+w:" + std::to_string(dim);
+    InitSchema(&item_schema, "f", "item", ARROW_FLAG_NULLABLE, 0, nullptr);
+    vector_schema_children[0] = &item_schema;
+    InitSchema(&vector_schema, vector_format.c_str(), "vector", ARROW_FLAG_NULLABLE, 1, vector_schema_children);
+    InitSchema(&id_schema, "i", "id", 0, 0, nullptr);
+    schema_children[0] = &id_schema;
+    schema_children[1] = &vector_schema;
+    InitSchema(&schema, "+s", "", 0, 2, schema_children);
+
+    int64_t length = (int64_t)ids.size();
+    item_buffers[0] = nullptr;
+    item_buffers[1] = vectors.data();
+    InitArray(&item_array, length * dim, 2, item_buffers, 0, nullptr);
+    vector_buffers[0] = nullptr;
+    vector_array_children[0] = &item_array;
+    InitArray(&vector_array, length, 1, vector_buffers, 1, vector_array_children);
+    id_buffers[0] = nullptr;
+    id_buffers[1] = ids.data();
+    InitArray(&id_array, length, 2, id_buffers, 0, nullptr);
+    struct_buffers[0] = nullptr;
+    array_children[0] = &id_array;
+    array_children[1] = &vector_array;
+    InitArray(&array, length, 1, struct_buffers, 2, array_children);
+  }
+
+  static void ReleaseSchema(ArrowSchema* s) {
+    for (int64_t i=0; i<s->n_children; i++) {
+      if (s->children[i]->release != nullptr) {
+        s->children[i]->release(s->children[i]);
+      }
+    }
+    s->release = nullptr;
+  }
+
+  static void ReleaseArray(ArrowArray* a) {
+    for (int64_t i=0; i<a->n_children; i++) {
+      if (a->children[i]->release != nullptr) {
+        a->children[i]->release(a->children[i]);
+      }
+    }
+    a->release = nullptr;
+  }
+
+  static void InitSchema(ArrowSchema* s, const char* format, const char* name, int64_t flags,
+                         int64_t n_children, ArrowSchema** children) {
+    *s = { format, name, nullptr, flags, n_children, children, nullptr, ReleaseSchema, nullptr };
+  }
+
+  static void InitArray(ArrowArray* a, int64_t length, int64_t n_buffers, const void** buffers,
+                        int64_t n_children, ArrowArray** children) {
+    *a = { length, 0, 0, n_buffers, n_children, buffers, children, nullptr, ReleaseArray, nullptr };
+  }
+
+  std::string vector_format;
+  ArrowSchema schema, id_schema, vector_schema, item_schema;
+  ArrowSchema* schema_children[2];
+  ArrowSchema* vector_schema_children[1];
+  ArrowArray array, id_array, vector_array, item_array;
+  ArrowArray* array_children[2];
+  ArrowArray* vector_array_children[1];
+  const void* struct_buffers[1];
+  const void* id_buffers[2];
+  const void* vector_buffers[1];
+  const void* item_buffers[2];
+};
+
+// Stream of a single batch.
+struct ArrowBatchStream {
+  static int GetSchema(ArrowArrayStream* stream, ArrowSchema* out) {
+    *out = static_cast<ArrowBatchStream*>(stream->private_data)->batch->schema;
+    return 0;
+  }
+
+  static int GetNext(ArrowArrayStream* stream, ArrowArray* out) {
+    auto* self = static_cast<ArrowBatchStream*>(stream->private_data);
+    if (self->done) {
+      out->release = nullptr;
+      return 0;
+    }
+    *out = self->batch->array;
+    self->done = true;
+    return 0;
+  }
+
+  static const char* GetLastError(ArrowArrayStream*) { return nullptr; }
+
+  static void Release(ArrowArrayStream* stream) {
+    static_cast<ArrowBatchStream*>(stream->private_data)->released = true;
+    stream->release = nullptr;
+  }
+
+  ArrowBatchExport* batch;
+  bool done = false;
+  bool released = false;
+};
+
+TEST(LanceDB, InsertArrow) {
+  system("rm -rf test_insert_arrow.db");
+  lancedb_handle_t handle = lancedb_init("test_insert_arrow.db");
+  ASSERT_NE(handle, nullptr);
+  int32_t dim = 8;
+  int32_t nz = 20;
+  std::vector<float> data(dim * nz);
+  for (int i=0; i<dim*nz; i++) {
+    data[i] = (float)(rand() % 1000) / 1000.f + 0.001f;
+  }
+  ASSERT_TRUE(lancedb_create_table(handle, "test_table", data.data(), dim, nz));
+
+  auto search_top_id = [&](const float* query) {
+    lancedb_data_t result_data;
+    EXPECT_TRUE(lancedb_search(handle, "test_table", "vector", (void*)query, dim, &result_data));
+    int32_t top_id = -1;
+    for (size_t i=0; i<result_data.num_fields; i++) {
+      if (strcmp(result_data.fields[i].name, "id") == 0 && result_data.fields[i].data_count > 0) {
+        top_id = ((int32_t*)result_data.fields[i].data)[0];
+      }
+    }
+    lancedb_free_search_results(&result_data);
+    return top_id;
+  };
+
+  std::vector<int32_t> ids = { 1000, 1001 };
+  std::vector<float> vectors(dim * 2, 0.f);
+  vectors[0] = 1.f;
+  vectors[dim + 1] = 1.f;
+  ArrowBatchExport batch(ids, vectors, dim);
+  ASSERT_TRUE(lancedb_insert_arrow(handle, "test_table", &batch.array, &batch.schema));
+  ASSERT_EQ(batch.array.release, nullptr);
+  ASSERT_NE(batch.schema.release, nullptr);
+  ASSERT_EQ(search_top_id(vectors.data()), 1000);
+  ASSERT_EQ(search_top_id(vectors.data() + dim), 1001);
+
+  // columns are matched by name, a list item named otherwise is accepted
+  std::vector<int32_t> reordered_ids = { 1002 };
+  std::vector<float> reordered_vectors(dim, 0.f);
+  reordered_vectors[3] = 1.f;
+  ArrowBatchExport reordered(reordered_ids, reordered_vectors, dim);
+  std::swap(reordered.schema_children[0], reordered.schema_children[1]);
+  std::swap(reordered.array_children[0], reordered.array_children[1]);
+  reordered.item_schema.name = "element";
+  ASSERT_TRUE(lancedb_insert_arrow(handle, "test_table", &reordered.array, &reordered.schema));
+  ASSERT_EQ(search_top_id(reordered_vectors.data()), 1002);
+
+  // non-nullable list items, as most producers export vectors, for the nullable table items
+  std::vector<int32_t> required_ids = { 1003 };
+  std::vector<float> required_vectors(dim, 0.f);
+  required_vectors[4] = 1.f;
+  ArrowBatchExport required(required_ids, required_vectors, dim);
+  required.item_schema.flags = 0;
+  ASSERT_TRUE(lancedb_insert_arrow(handle, "test_table", &required.array, &required.schema));
+  ASSERT_EQ(search_top_id(required_vectors.data()), 1003);
+
+  // uint32 ids for the int32 id column
+  ArrowBatchExport mistyped(reordered_ids, reordered_vectors, dim);
+  mistyped.id_schema.format = "I";
+  ASSERT_FALSE(lancedb_insert_arrow(handle, "test_table", &mistyped.array, &mistyped.schema));
+  ASSERT_EQ(mistyped.array.release, nullptr);
+
+  std::vector<int32_t> stream_ids = { 2000 };
+  std::vector<float> stream_vectors(dim, 0.f);
+  stream_vectors[2] = 1.f;
+  ArrowBatchExport stream_batch(stream_ids, stream_vectors, dim);
+  ArrowBatchStream stream_data;
+  stream_data.batch = &stream_batch;
+  ArrowArrayStream stream = { ArrowBatchStream::GetSchema, ArrowBatchStream::GetNext,
+                              ArrowBatchStream::GetLastError, ArrowBatchStream::Release, &stream_data };
+  ASSERT_TRUE(lancedb_insert_arrow_stream(handle, "test_table", &stream));
+  ASSERT_TRUE(stream_data.released);
+  ASSERT_EQ(search_top_id(stream_vectors.data()), 2000);
+
+  lancedb_close(handle);
+}
+
+// Produces `num_batches` batches of `batch_size` rows, reusing the same buffers for each batch.
+struct BatchProducer {
+  static int Produce(void* user_data, lancedb_data_t* batch) {
+    auto* self = static_cast<BatchProducer*>(user_data);
+    if (self->produced == self->num_batches) {
+      return 0;
+    }
+    for (int i=0; i<self->batch_size; i++) {
+      int32_t id = self->first_id + self->produced * self->batch_size + i;
+      self->ids[i] = id;
+      for (int j=0; j<self->dim; j++) {
+        self->vectors[i * self->dim + j] = (float)((id + j) % 17) + 1.f;
+      }
+    }
+    self->fields[0] = { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar,
+                        (size_t)self->batch_size, 1, self->ids.data(), nullptr, nullptr };
+    self->fields[1] = { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector,
+                        (size_t)self->batch_size, (size_t)self->dim, self->vectors.data(), nullptr, nullptr };
+    batch->fields = self->fields;
+    batch->num_fields = 2;
+    self->produced++;
+    return 1;
+  }
+
+  BatchProducer(int first_id, int num_batches, int batch_size, int dim)
+      : first_id(first_id), num_batches(num_batches), batch_size(batch_size), dim(dim),
+        ids(batch_size), vectors(batch_size * dim) {}
+
+  int first_id;
+  int num_batches;
+  int batch_size;
+  int dim;
+  int produced = 0;
+  std::vector<int32_t> ids;
+  std::vector<float> vectors;
+  lancedb_field_data_t fields[2];
+};
+
+TEST(LanceDB, InsertStream) {
+  system("rm -rf test_insert_stream.db");
+  lancedb_handle_t handle = lancedb_init("test_insert_stream.db");
+  ASSERT_NE(handle, nullptr);
+  int dim = 8;
+
+  lancedb_table_field_t schema_fields[2] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 0, 1, 0 },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 0, dim, 0 },
+  };
+  lancedb_schema_t schema = { schema_fields, 2 };
+  BatchProducer create_producer(0, 3, 10, dim);
+  ASSERT_TRUE(lancedb_create_table_stream(handle, "test_table", &schema,
+                                          BatchProducer::Produce, &create_producer));
+  ASSERT_EQ(create_producer.produced, 3);
+
+  BatchProducer insert_producer(1000, 2, 10, dim);
+  ASSERT_TRUE(lancedb_insert_stream(handle, "test_table", BatchProducer::Produce, &insert_producer));
+  ASSERT_EQ(insert_producer.produced, 2);
+
+  // a failing producer commits nothing
+  auto failing = [](void*, lancedb_data_t*) { return -1; };
+  ASSERT_FALSE(lancedb_insert_stream(handle, "test_table", failing, nullptr));
+  // and so does a batch without fields
+  auto no_fields = [](void*, lancedb_data_t* batch) {
+    batch->fields = nullptr;
+    batch->num_fields = 0;
+    return 1;
+  };
+  ASSERT_FALSE(lancedb_insert_stream(handle, "test_table", no_fields, nullptr));
+  ASSERT_FALSE(lancedb_insert_stream(handle, "no_such_table", BatchProducer::Produce, &insert_producer));
+
+  lancedb_table_handle_t table = lancedb_open_table(handle, "test_table");
+  ASSERT_NE(table, nullptr);
+  lancedb_data_t result_data;
+  ASSERT_TRUE(lancedb_table_search(table, "vector", insert_producer.vectors.data(), dim, &result_data));
+  ASSERT_GT(result_data.num_fields, 0);
+  lancedb_free_search_results(&result_data);
+  lancedb_table_close(table);
+  lancedb_close(handle);
+}
+
+TEST(LanceDB, ContiguousStrings) {
+  system("rm -rf test_contiguous_strings.db");
+  lancedb_handle_t handle = lancedb_init("test_contiguous_strings.db");
+  ASSERT_NE(handle, nullptr);
+
+  lancedb_table_field_t schema_fields[3] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 0, 1, 0 },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 0, 2, 0 },
+      { "comment", kLanceDBFieldTypeString, kLanceDBFieldTypeScalar, 0, 1, 0 },
+  };
+  lancedb_schema_t schema = { schema_fields, 3 };
+  ASSERT_TRUE(lancedb_create_table_with_schema(handle, "test_table", &schema));
+
+  std::vector<int32_t> ids = { 0, 1, 2 };
+  std::vector<float> vectors = { 1.f, 0.f, 0.f, 1.f, 1.f, 1.f };
+  std::string comments = "firstsecond";
+  size_t offsets[4] = { 0, 5, 11, 11 };
+  lancedb_field_data_t fields[3] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 3, 1, ids.data(), nullptr, nullptr },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 3, 2, vectors.data(), nullptr, nullptr },
+      { "comment", kLanceDBFieldTypeString, kLanceDBFieldTypeScalar, 3, 1, (void*)comments.data(), nullptr, offsets },
+  };
+  lancedb_data_t insert_data = { fields, 3 };
+  ASSERT_TRUE(lancedb_insert(handle, "test_table", &insert_data));
+
+  lancedb_data_t result_data;
+  ASSERT_TRUE(lancedb_search(handle, "test_table", "vector", vectors.data() + 2, 2, &result_data));
+  lancedb_field_data_t* comment_field = nullptr;
+  for (size_t i=0; i<result_data.num_fields; i++) {
+    if (strcmp(result_data.fields[i].name, "comment") == 0) {
+      comment_field = &result_data.fields[i];
+    }
+  }
+  ASSERT_NE(comment_field, nullptr);
+  ASSERT_EQ(comment_field->data_count, 3);
+  ASSERT_NE(comment_field->offsets, nullptr);
+  const char* values = (const char*)comment_field->data;
+  std::string top(values + comment_field->offsets[0], comment_field->offsets[1] - comment_field->offsets[0]);
+  ASSERT_EQ(top, "second");
+  ASSERT_EQ(comment_field->offsets[comment_field->data_count], 11);
+  lancedb_free_search_results(&result_data);
+  lancedb_close(handle);
+}
+
+static std::vector<int32_t> SearchIds(lancedb_handle_t handle, const char* table_name, float* query, int dim) {
+  std::vector<int32_t> ids;
+  lancedb_data_t result_data;
+  if (!lancedb_search(handle, table_name, "vector", query, dim, &result_data)) {
+    return ids;
+  }
+  for (size_t i=0; i<result_data.num_fields; i++) {
+    if (strcmp(result_data.fields[i].name, "id") == 0) {
+      int32_t* data = (int32_t*)result_data.fields[i].data;
+      ids.assign(data, data + result_data.fields[i].data_count);
+    }
+  }
+  lancedb_free_search_results(&result_data);
+  return ids;
+}
+
+TEST(LanceDB, ImportVectors) {
+  system("rm -rf test_import.db");
+  lancedb_handle_t handle = lancedb_init("test_import.db");
+  ASSERT_NE(handle, nullptr);
+
+  // test_data.bin is raw float32 vectors after a dim, nz, k header and k target indexes
+  int32_t header[3];
+  FILE* fp = fopen("test/data/test_data.bin", "rb");
+  ASSERT_NE(fp, nullptr);
+  fread(header, sizeof(int32_t), 3, fp);
+  int32_t dim = header[0], nz = header[1], k = header[2];
+  std::vector<int32_t> target_indexes(k, 0);
+  fread(target_indexes.data(), sizeof(int32_t), k, fp);
+  std::vector<float> data(dim * nz);
+  fread(data.data(), sizeof(float), dim * nz, fp);
+  fclose(fp);
+
+  lancedb_import_options_t options = {};
+  options.id_column = "id";
+  options.dimension = dim;
+  options.header_size = sizeof(int32_t) * (3 + k);
+  options.chunk_rows = 32;
+  options.create_table = 1;
+  ASSERT_TRUE(lancedb_import_vectors(handle, "raw_table", "test/data/test_data.bin",
+                                     kLanceDBVectorFormatRaw, &options));
+  lancedb_data_t result_data;
+  ASSERT_TRUE(lancedb_search(handle, "raw_table", "vector", data.data() + dim * 33, dim, &result_data));
+  for (size_t i=0; i<result_data.num_fields; i++) {
+    if (strcmp(result_data.fields[i].name, "id") == 0) {
+      ASSERT_EQ(result_data.fields[i].data_count, (size_t)k);
+      for (int j=0; j<k; j++) {
+        ASSERT_EQ(((int32_t*)result_data.fields[i].data)[j], target_indexes[j]);
+      }
+    }
+  }
+  lancedb_free_search_results(&result_data);
+
+  // the same vectors as fvecs and npy, appended after the raw ones
+  const int rows = 10;
+  fp = fopen("test_import.fvecs", "wb");
+  ASSERT_NE(fp, nullptr);
+  for (int i=0; i<rows; i++) {
+    fwrite(&dim, sizeof(int32_t), 1, fp);
+    fwrite(data.data() + dim * i, sizeof(float), dim, fp);
+  }
+  fclose(fp);
+
+  std::string npy_header = "{'descr': '<f4', 'fortran_order': False, 'shape': (" +
+                           std::to_string(rows) + ", " + std::to_string(dim) + "), }";
+  npy_header.append(64 - (10 + npy_header.size() + 1) % 64, ' ');
+  npy_header.push_back('\n');
+  uint16_t npy_header_len = (uint16_t)npy_header.size();
+  fp = fopen("test_import.npy", "wb");
+  ASSERT_NE(fp, nullptr);
+  fwrite("\x93NUMPY\x01\x00", 1, 8, fp);
+  fwrite(&npy_header_len, sizeof(uint16_t), 1, fp);
+  fwrite(npy_header.data(), 1, npy_header.size(), fp);
+  fwrite(data.data(), sizeof(float), dim * rows, fp);
+  fclose(fp);
+
+  options = {};
+  options.id_column = "id";
+  options.first_id = nz;
+  ASSERT_TRUE(lancedb_import_vectors(handle, "raw_table", "test_import.fvecs",
+                                     kLanceDBVectorFormatFvecs, &options));
+  options.first_id = nz + rows;
+  ASSERT_TRUE(lancedb_import_vectors(handle, "raw_table", "test_import.npy",
+                                     kLanceDBVectorFormatNpy, &options));
+
+  options.dimension = dim + 1;
+  ASSERT_FALSE(lancedb_import_vectors(handle, "raw_table", "test_import.npy",
+                                      kLanceDBVectorFormatNpy, &options));
+  ASSERT_FALSE(lancedb_import_vectors(handle, "raw_table", "no_such_file.npy",
+                                      kLanceDBVectorFormatNpy, nullptr));
+
+  // ids past the Int32 id column, and a corrupted fvecs dimension
+  options = {};
+  options.id_column = "id";
+  options.first_id = INT32_MAX - 2;
+  ASSERT_FALSE(lancedb_import_vectors(handle, "raw_table", "test_import.fvecs",
+                                      kLanceDBVectorFormatFvecs, &options));
+  fp = fopen("test_import_bad.fvecs", "wb");
+  ASSERT_NE(fp, nullptr);
+  int32_t bad_dim = -1;
+  fwrite(&bad_dim, sizeof(int32_t), 1, fp);
+  fwrite(data.data(), sizeof(float), dim, fp);
+  fclose(fp);
+  ASSERT_FALSE(lancedb_import_vectors(handle, "raw_table", "test_import_bad.fvecs",
+                                      kLanceDBVectorFormatFvecs, nullptr));
+
+  // a last row cut short is refused, not dropped
+  fp = fopen("test_import_truncated.fvecs", "wb");
+  ASSERT_NE(fp, nullptr);
+  for (int i=0; i<2; i++) {
+    fwrite(&dim, sizeof(int32_t), 1, fp);
+    fwrite(data.data() + dim * i, sizeof(float), i == 0 ? dim : dim / 2, fp);
+  }
+  fclose(fp);
+  ASSERT_FALSE(lancedb_import_vectors(handle, "raw_table", "test_import_truncated.fvecs",
+                                      kLanceDBVectorFormatFvecs, nullptr));
+  options = {};
+  options.dimension = dim;
+  options.header_size = sizeof(int32_t) * (3 + k) + sizeof(float);
+  ASSERT_FALSE(lancedb_import_vectors(handle, "raw_table", "test/data/test_data.bin",
+                                      kLanceDBVectorFormatRaw, &options));
+
+  // vector 3 is now in the table three times, under the ids given to each import
+  std::vector<int32_t> ids = SearchIds(handle, "raw_table", data.data() + dim * 3, dim);
+  ASSERT_GE(ids.size(), 3);
+  std::sort(ids.begin(), ids.begin() + 3);
+  ASSERT_EQ(ids[0], 3);
+  ASSERT_EQ(ids[1], nz + 3);
+  ASSERT_EQ(ids[2], nz + rows + 3);
+
+  lancedb_close(handle);
+  remove("test_import.fvecs");
+  remove("test_import.npy");
+  remove("test_import_bad.fvecs");
+  remove("test_import_truncated.fvecs");
+}
+
+TEST(LanceDB, Optimize) {
+  system("rm -rf test_optimize.db");
+  lancedb_handle_t handle = lancedb_init("test_optimize.db");
+  ASSERT_NE(handle, nullptr);
+  int32_t dim = 8;
+  std::vector<float> data(dim * 10);
+  for (size_t i=0; i<data.size(); i++) {
+    data[i] = (float)(rand() % 1000) / 1000.f;
+  }
+  ASSERT_TRUE(lancedb_create_table(handle, "test_table", data.data(), dim, 1));
+
+  // one fragment per insert
+  for (int32_t i=1; i<10; i++) {
+    lancedb_field_data_t fields[2] = {
+        { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 1, 1, &i, nullptr, nullptr },
+        { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 1, (size_t)dim, data.data() + dim * i, nullptr, nullptr },
+    };
+    lancedb_data_t insert_data = { fields, 2 };
+    ASSERT_TRUE(lancedb_insert(handle, "test_table", &insert_data));
+  }
+
+  lancedb_optimize_options_t options = {};
+  options.compact = 1;
+  lancedb_optimize_stats_t stats;
+  ASSERT_TRUE(lancedb_optimize(handle, "test_table", &options, &stats));
+  printf("compaction: %llu fragments removed, %llu added in %llu ms\n",
+         (unsigned long long)stats.fragments_removed, (unsigned long long)stats.fragments_added,
+         (unsigned long long)stats.elapsed_ms);
+  ASSERT_EQ(stats.fragments_removed, 10);
+  ASSERT_EQ(stats.fragments_added, 1);
+  ASSERT_EQ(stats.versions_removed, 0);
+
+  // all the versions but the latest are older than a second now
+  std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+  options = {};
+  options.prune = 1;
+  options.prune_older_than_secs = 1;
+  ASSERT_TRUE(lancedb_optimize(handle, "test_table", &options, &stats));
+  ASSERT_GT(stats.versions_removed, 0);
+  ASSERT_GT(stats.bytes_removed, 0);
+  ASSERT_EQ(stats.fragments_removed, 0);
+
+  // 0 prunes the version replaced by the insert right away, the default age keeps it
+  int32_t last_id = 10;
+  lancedb_field_data_t fields[2] = {
+      { "id", kLanceDBFieldTypeInt32, kLanceDBFieldTypeScalar, 1, 1, &last_id, nullptr, nullptr },
+      { "vector", kLanceDBFieldTypeFloat32, kLanceDBFieldTypeVector, 1, (size_t)dim, data.data(), nullptr, nullptr },
+  };
+  lancedb_data_t insert_data = { fields, 2 };
+  ASSERT_TRUE(lancedb_insert(handle, "test_table", &insert_data));
+  options = {};
+  options.prune = 1;
+  options.prune_older_than_secs = LANCEDB_PRUNE_DEFAULT_AGE;
+  ASSERT_TRUE(lancedb_optimize(handle, "test_table", &options, &stats));
+  ASSERT_EQ(stats.versions_removed, 0);
+  options.prune_older_than_secs = 0;
+  ASSERT_TRUE(lancedb_optimize(handle, "test_table", &options, &stats));
+  ASSERT_EQ(stats.versions_removed, 1);
+
+  ASSERT_TRUE(lancedb_optimize(handle, "test_table", nullptr, nullptr));
+  ASSERT_FALSE(lancedb_optimize(handle, "no_such_table", nullptr, nullptr));
+
+  lancedb_data_t result_data;
+  ASSERT_TRUE(lancedb_search(handle, "test_table", "vector", data.data() + dim * 7, dim, &result_data));
+  for (size_t i=0; i<result_data.num_fields; i++) {
+    if (strcmp(result_data.fields[i].name, "id") == 0) {
+      ASSERT_EQ(((int32_t*)result_data.fields[i].data)[0], 7);
+    }
+  }
+  lancedb_free_search_results(&result_data);
+  lancedb_close(handle);
+}
@@ -4,8 +4,10 @@
 #include "table_schema.hpp"
 #include "lancedb_tools.hpp"
 
+#include <chrono>
 #include <cstdlib>
 #include <cmath>
+#include <thread>
 
 using namespace lancedb;
 
@@ -65,12 +67,21 @@ TEST(LanceDB, FieldData) {
   ASSERT_EQ(field_data7.GetDataType(), kLanceDBFieldTypeString);
   ASSERT_EQ(field_data7.GetDimension(), 1);
   ASSERT_TRUE(field_data7.IsDataValid());
-  auto& flatdata3 = field_data7.GetFlattenData();
+  auto& values7 = field_data7.GetValues();
+  auto& offsets7 = field_data7.GetOffsets();
+  ASSERT_EQ(offsets7.size(), 4u);
   printf("flat data: ");
-  for (auto i : flatdata3) {
-    printf("%s   ", i);
+  for (size_t i = 0; i + 1 < offsets7.size(); i++) {
+    printf("%.*s   ", (int)(offsets7[i + 1] - offsets7[i]), (const char*)values7.data() + offsets7[i]);
   }
   printf("\n");
+  auto cfd7 = LanceDB::GetCFieldData(field_data7);
+  ASSERT_EQ(cfd7.data_count, 3);
+  ASSERT_EQ(cfd7.offsets[0], 0);
+  ASSERT_EQ(cfd7.offsets[1], 5);
+  ASSERT_EQ(cfd7.offsets[2], 10);
+  ASSERT_EQ(cfd7.offsets[3], 11);
+  ASSERT_EQ(std::string((const char*)cfd7.data, cfd7.offsets[3]), "hellokitty!");
 
   LanceDB::FieldData field_data8("test7",
                                         std::vector<const char*>{ "hello", "world" });
@@ -108,10 +119,12 @@ TEST(LanceDB, FieldData) {
     ASSERT_EQ(field_data9.GetDataType(), kLanceDBFieldTypeString);
     ASSERT_EQ(field_data9.GetDimension(), 1);
     ASSERT_TRUE(field_data9.IsDataValid());
-    auto& flatdata9 = field_data9.GetFlattenData();
+    auto& values9 = field_data9.GetValues();
+    auto& offsets9 = field_data9.GetOffsets();
+    ASSERT_EQ(offsets9.size(), 3u);
     printf("flat data: ");
-    for (auto& i : flatdata9) {
-      printf("%s   ", i);
+    for (size_t i = 0; i + 1 < offsets9.size(); i++) {
+      printf("%.*s   ", (int)(offsets9[i + 1] - offsets9[i]), (const char*)values9.data() + offsets9[i]);
     }
     printf("\n");
   }
@@ -128,13 +141,13 @@ TEST(LanceDB, FieldData) {
     ASSERT_EQ(test_data.GetDataType(), kLanceDBFieldTypeBlob);
     ASSERT_EQ(test_data.GetDimension(), 1);
     ASSERT_TRUE(test_data.IsDataValid());
-    auto& flatdata = test_data.GetFlattenData();
-    auto& ds = test_data.GetBinaryDataSize();
-    ASSERT_EQ(flatdata.size(), ds.size());
+    auto& values = test_data.GetValues();
+    auto& offsets = test_data.GetOffsets();
+    ASSERT_EQ(offsets.size(), 3u);
     printf("flat data: ");
-    for (int i=0; i<flatdata.size(); i++) {
-      for (auto j=0; j<ds[i]; j++) {
-        printf("%d  ", flatdata[i][j]);
+    for (size_t i = 0; i + 1 < offsets.size(); i++) {
+      for (size_t j = offsets[i]; j < offsets[i + 1]; j++) {
+        printf("%d  ", values[j]);
       }
       printf("\n");
     }
@@ -152,13 +165,13 @@ TEST(LanceDB, FieldData) {
     ASSERT_EQ(test_data.GetDataType(), kLanceDBFieldTypeBlob);
     ASSERT_EQ(test_data.GetDimension(), 1);
     ASSERT_TRUE(test_data.IsDataValid());
-    auto& flatdata = test_data.GetFlattenData();
-    auto& ds = test_data.GetBinaryDataSize();
-    ASSERT_EQ(flatdata.size(), ds.size());
+    auto& values = test_data.GetValues();
+    auto& offsets = test_data.GetOffsets();
+    ASSERT_EQ(offsets.size(), 3u);
     printf("flat data: ");
-    for (int i=0; i<flatdata.size(); i++) {
-      for (auto j=0; j<ds[i]; j++) {
-        printf("%d  ", flatdata[i][j]);
+    for (size_t i = 0; i + 1 < offsets.size(); i++) {
+      for (size_t j = offsets[i]; j < offsets[i + 1]; j++) {
+        printf("%d  ", values[j]);
       }
       printf("\n");
     }
@@ -169,10 +182,13 @@ TEST(LanceDB, FieldData) {
     ASSERT_EQ(cfd.field_type, kLanceDBFieldTypeScalar);
     ASSERT_EQ(cfd.data_count, 2);
     ASSERT_EQ(cfd.dimension, 1);
-    ASSERT_EQ(cfd.binary_size[0], 5);
-    ASSERT_EQ(cfd.binary_size[1], 8);
-    ASSERT_EQ(((uint8_t**)cfd.data)[0][0], 1);
-    ASSERT_EQ(((uint8_t**)cfd.data)[0][1], 2);
+    ASSERT_EQ(cfd.binary_size, nullptr);
+    ASSERT_EQ(cfd.offsets[0], 0);
+    ASSERT_EQ(cfd.offsets[1], 5);
+    ASSERT_EQ(cfd.offsets[2], 13);
+    ASSERT_EQ(((uint8_t*)cfd.data)[0], 1);
+    ASSERT_EQ(((uint8_t*)cfd.data)[1], 2);
+    ASSERT_EQ(((uint8_t*)cfd.data)[5], 2);
   }
 }
 
@@ -233,6 +249,616 @@ TEST(LanceDB, BatchInserter) {
   LanceDBTool::PrintResult(sr.Get());
 }
 
+TEST(LanceDB, Table) {
+  system("rm -rf test_table.db");
+  LanceDB db("test_table.db");
+  std::vector<int> idx = { 0, 1, 2, 3 };
+  std::vector<std::vector<float>> embeddings = {
+      { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f }, { 1.f, 1.f, 0.f } };
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+  ASSERT_EQ(inserter.CreateTable("test_table"), kLanceDBSuccess);
+
+  Table table;
+  ASSERT_FALSE(table.IsOpened());
+  ASSERT_EQ(db.OpenTable("test_table", table), kLanceDBSuccess);
+  ASSERT_TRUE(table.IsOpened());
+  ASSERT_EQ(inserter.Insert(table), kLanceDBSuccess);
+  ASSERT_EQ(inserter.Insert(table), kLanceDBSuccess);
+
+  LanceDB::SearchResults sr;
+  ASSERT_EQ(db.Query(table, "embedding", std::vector<float>{ 0.f, 1.f, 0.f }, sr), kLanceDBSuccess);
+  ASSERT_TRUE(sr.IsValid());
+  ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], 1);
+
+  Table moved = std::move(table);
+  ASSERT_FALSE(table.IsOpened());
+  ASSERT_TRUE(moved.IsOpened());
+  ASSERT_EQ(moved.GetName(), "test_table");
+}
+
+TEST(LanceDB, FieldDataView) {
+  system("rm -rf test_field_data_view.db");
+  LanceDB db("test_field_data_view.db");
+  const int dim = 4;
+  const size_t count = 3;
+  int32_t idx[count] = { 10, 11, 12 };
+  std::vector<float> embeddings = { 1.f, 0.f, 0.f, 0.f,
+                                    0.f, 1.f, 0.f, 0.f,
+                                    0.f, 0.f, 1.f, 0.f };
+  const char* comment_values = "aabbbc";
+  size_t comment_offsets[count + 1] = { 0, 2, 5, 6 };
+
+  LanceDB::FieldDataView<int32_t> idx_view("idx", idx, count);
+  LanceDB::FieldDataView<float> embedding_view("embedding", embeddings, kLanceDBFieldTypeVector, dim);
+  LanceDB::FieldDataView<std::string> comment_view("comment", (const uint8_t*)comment_values,
+                                                   comment_offsets, count);
+  ASSERT_TRUE(idx_view.IsDataValid());
+  ASSERT_TRUE(embedding_view.IsDataValid());
+  ASSERT_TRUE(comment_view.IsDataValid());
+  ASSERT_EQ(embedding_view.GetDataCount(), count);
+
+  // the C field data points at the caller memory
+  LanceDB::CFieldData cfd = LanceDB::GetCFieldData(embedding_view);
+  ASSERT_EQ(cfd.data, embeddings.data());
+  ASSERT_EQ(cfd.dimension, dim);
+  cfd = LanceDB::GetCFieldData(comment_view);
+  ASSERT_EQ(cfd.data, comment_values);
+  ASSERT_EQ(cfd.offsets, comment_offsets);
+
+  auto inserter = db.CreateBatchInserter(idx_view, embedding_view, comment_view);
+  ASSERT_EQ(inserter.CreateTable("test_table"), kLanceDBSuccess);
+  ASSERT_EQ(inserter.Insert("test_table"), kLanceDBSuccess);
+
+  LanceDB::SearchResults sr;
+  ASSERT_EQ(db.Query("test_table", "embedding", std::vector<float>{ 0.f, 1.f, 0.f, 0.f }, sr), kLanceDBSuccess);
+  ASSERT_TRUE(sr.IsValid());
+  ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], 11);
+
+  // a range that is not a whole number of vectors
+  LanceDB::FieldDataView<float> bad_view("embedding", embeddings, kLanceDBFieldTypeVector, 5);
+  ASSERT_FALSE(bad_view.IsDataValid());
+
+  // owning field data taking the containers over
+  std::vector<int> moved_idx = { 20, 21 };
+  LanceDB::FieldData moved_idx_data("idx", std::move(moved_idx));
+  ASSERT_EQ(moved_idx_data.GetDataCount(), 2);
+  ASSERT_EQ(moved_idx_data.GetFlattenData().data(), moved_idx_data.GetData().data());
+}
+
+TEST(LanceDB, BackgroundInserter) {
+  system("rm -rf test_background_inserter.db");
+  LanceDB db("test_background_inserter.db");
+  const int dim = 4;
+  const size_t batch_size = 8;
+  std::vector<int32_t> idx(batch_size);
+  std::vector<float> embeddings(batch_size * dim);
+
+  // the same buffers are refilled for every batch
+  auto fill = [&](int batch) {
+    for (size_t i=0; i<batch_size; i++) {
+      idx[i] = batch * batch_size + i;
+      for (int j=0; j<dim; j++) {
+        embeddings[i * dim + j] = (float)(idx[i] + j);
+      }
+    }
+  };
+  fill(0);
+  LanceDB::FieldDataView<int32_t> idx_view("idx", idx);
+  LanceDB::FieldDataView<float> embedding_view("embedding", embeddings, kLanceDBFieldTypeVector, dim);
+  ASSERT_EQ(db.CreateBatchInserter(idx_view, embedding_view).CreateTable("test_table"), kLanceDBSuccess);
+
+  LanceDB::BackgroundInserter inserter;
+  ASSERT_EQ(inserter.Submit(idx_view, embedding_view), kLanceDBInvalidOperation);
+  ASSERT_EQ(db.OpenBackgroundInserter("no_such_table", inserter), kLanceDBInternalError);
+  ASSERT_EQ(db.OpenBackgroundInserter("test_table", inserter), kLanceDBSuccess);
+  for (int batch=0; batch<5; batch++) {
+    fill(batch);
+    ASSERT_EQ(inserter.Submit(idx_view, embedding_view), kLanceDBSuccess);
+  }
+  ASSERT_EQ(inserter.Submit(embedding_view, idx_view), kLanceDBInvalidArgument);
+  ASSERT_EQ(inserter.Close(), kLanceDBSuccess);
+  ASSERT_FALSE(inserter.IsOpened());
+
+  for (int32_t expected: { 3, 20, 39 }) {
+    std::vector<float> query(dim);
+    for (int j=0; j<dim; j++) {
+      query[j] = (float)(expected + j);
+    }
+    LanceDB::SearchResults sr;
+    ASSERT_EQ(db.Query("test_table", "embedding", query, sr), kLanceDBSuccess);
+    ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], expected);
+  }
+}
+
+TEST(LanceDB, WriteBuffer) {
+  system("rm -rf test_write_buffer.db");
+  LanceDB db("test_write_buffer.db");
+  std::vector<int> idx = { 0 };
+  std::vector<std::vector<float>> embeddings = { { 1.f, 0.f, 0.f } };
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  ASSERT_EQ(db.CreateBatchInserter(idx_data, embedding_data).CreateTable("test_table"), kLanceDBSuccess);
+
+  LanceDB::WriteBuffer write_buffer;
+  ASSERT_EQ(write_buffer.Write(idx_data, embedding_data), kLanceDBInvalidOperation);
+  LanceDB::WriteBuffer::Options options;
+  options.flush_interval_ms = 50;
+  ASSERT_EQ(db.OpenWriteBuffer("test_table", write_buffer, options), kLanceDBSuccess);
+
+  // many writers of a single row each
+  const int num_threads = 8;
+  const int num_writes = 25;
+  std::vector<std::thread> writers;
+  for (int t=0; t<num_threads; t++) {
+    writers.emplace_back([&, t]() {
+      for (int i=0; i<num_writes; i++) {
+        std::vector<int> row_idx = { t * num_writes + i };
+        std::vector<std::vector<float>> row_embedding = { { 0.f, 1.f, (float)row_idx[0] } };
+        LanceDB::FieldData row_idx_data("idx", row_idx);
+        LanceDB::FieldData row_embedding_data("embedding", row_embedding);
+        EXPECT_EQ(write_buffer.Write(row_idx_data, row_embedding_data), kLanceDBSuccess);
+      }
+    });
+  }
+  for (auto& th: writers) {
+    th.join();
+  }
+  ASSERT_EQ(write_buffer.Flush(), kLanceDBSuccess);
+
+  lancedb_write_buffer_stats_t stats;
+  ASSERT_EQ(write_buffer.GetStats(stats), kLanceDBSuccess);
+  ASSERT_EQ(stats.num_writes, num_threads * num_writes);
+  ASSERT_EQ(stats.num_committed_rows, num_threads * num_writes);
+  ASSERT_EQ(stats.num_failed_commits, 0);
+  ASSERT_EQ(stats.pending_rows, 0);
+  ASSERT_GE(stats.num_commits, 1);
+  ASSERT_LT(stats.num_commits, stats.num_writes);
+  ASSERT_LE(stats.min_commit_rows, stats.max_commit_rows);
+  printf("%llu writes in %llu commits, %llu to %llu rows per commit\n",
+         (unsigned long long)stats.num_writes, (unsigned long long)stats.num_commits,
+         (unsigned long long)stats.min_commit_rows, (unsigned long long)stats.max_commit_rows);
+  ASSERT_EQ(write_buffer.Close(), kLanceDBSuccess);
+
+  // rows of another schema are refused by the writer, before they are queued
+  options.wait_for_commit = true;
+  ASSERT_EQ(db.OpenWriteBuffer("test_table", write_buffer, options), kLanceDBSuccess);
+  ASSERT_EQ(write_buffer.Write(embedding_data), kLanceDBInsertFailed);
+  std::vector<int> last_idx = { 1000 };
+  std::vector<std::vector<float>> last_embedding = { { 0.f, 0.f, 1.f } };
+  LanceDB::FieldData last_idx_data("idx", last_idx);
+  LanceDB::FieldData last_embedding_data("embedding", last_embedding);
+  ASSERT_EQ(write_buffer.Write(last_idx_data, last_embedding_data), kLanceDBSuccess);
+  // committed when the write returns
+  ASSERT_EQ(write_buffer.GetStats(stats), kLanceDBSuccess);
+  ASSERT_EQ(stats.num_committed_rows, 1);
+  LanceDB::SearchResults sr;
+  ASSERT_EQ(db.Query("test_table", "embedding", std::vector<float>{ 0.f, 0.f, 1.f }, sr), kLanceDBSuccess);
+  ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], 1000);
+  ASSERT_EQ(write_buffer.Close(), kLanceDBSuccess);
+}
+
+TEST(LanceDB, Upsert) {
+  system("rm -rf test_upsert.db");
+  LanceDB db("test_upsert.db");
+  std::vector<int> idx = { 0, 1, 2, 3 };
+  std::vector<std::vector<float>> embeddings = {
+      { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f }, { 0.f, 0.f, 1.f }, { 1.f, 1.f, 0.f } };
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+  ASSERT_EQ(inserter.CreateTable("test_table"), kLanceDBSuccess);
+  ASSERT_EQ(inserter.Insert("test_table"), kLanceDBSuccess);
+
+  auto nearest_idx = [&](std::vector<float> query) {
+    LanceDB::SearchResults sr;
+    EXPECT_EQ(db.Query("test_table", "embedding", query, sr), kLanceDBSuccess);
+    return ((int32_t*)sr.Get().fields[0].data)[0];
+  };
+  auto upsert = [&](std::vector<int> keys, std::vector<std::vector<float>> values, lancedb_upsert_mode_t mode) {
+    LanceDB::FieldData key_data("idx", keys);
+    LanceDB::FieldData value_data("embedding", values);
+    return db.Upsert("test_table", "idx", mode, key_data, value_data);
+  };
+
+  // row 1 is replaced, row 10 is new
+  ASSERT_EQ(upsert({ 1, 10 }, { { 5.f, 5.f, 5.f }, { -5.f, 0.f, 0.f } }, kLanceDBUpsertUpdateOrInsert),
+            kLanceDBSuccess);
+  ASSERT_EQ(nearest_idx({ 5.f, 5.f, 5.f }), 1);
+  ASSERT_EQ(nearest_idx({ -5.f, 0.f, 0.f }), 10);
+  ASSERT_EQ(nearest_idx({ 0.f, 1.f, 0.f }), 3);
+
+  // only existing rows are updated
+  ASSERT_EQ(upsert({ 2, 20 }, { { 0.f, 0.f, 9.f }, { 0.f, -9.f, 0.f } }, kLanceDBUpsertUpdateOnly),
+            kLanceDBSuccess);
+  ASSERT_EQ(nearest_idx({ 0.f, 0.f, 9.f }), 2);
+  ASSERT_NE(nearest_idx({ 0.f, -9.f, 0.f }), 20);
+
+  // only new rows are inserted
+  ASSERT_EQ(upsert({ 0, 30 }, { { 0.f, 7.f, -7.f }, { 7.f, -7.f, 0.f } }, kLanceDBUpsertInsertOnly),
+            kLanceDBSuccess);
+  ASSERT_EQ(nearest_idx({ 7.f, -7.f, 0.f }), 30);
+  ASSERT_NE(nearest_idx({ 0.f, 7.f, -7.f }), 0);
+  ASSERT_EQ(nearest_idx({ 1.f, 0.f, 0.f }), 0);
+
+  ASSERT_EQ(upsert({ 1 }, { { 1.f, 1.f, 1.f } }, kLanceDBUpsertUpdateOrInsert), kLanceDBSuccess);
+  LanceDB::FieldData key_data("no_such_key", std::vector<int>{ 1 });
+  ASSERT_EQ(db.Upsert("test_table", "no_such_key", kLanceDBUpsertUpdateOrInsert, key_data, embedding_data),
+            kLanceDBInsertFailed);
+}
+
+TEST(LanceDB, WriteOptions) {
+  system("rm -rf test_write_options.db");
+  LanceDB db("test_write_options.db");
+  std::vector<int> idx;
+  std::vector<std::vector<float>> embeddings;
+  for (int i=0; i<100; i++) {
+    idx.push_back(i);
+    embeddings.push_back({ (float)i, 1.f, 0.f });
+  }
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+
+  auto nearest_idx = [&](std::vector<float> query) {
+    LanceDB::SearchResults sr;
+    EXPECT_EQ(db.Query("test_table", "embedding", query, sr), kLanceDBSuccess);
+    return ((int32_t*)sr.Get().fields[0].data)[0];
+  };
+
+  // created with its rows, in small files
+  LanceDB::WriteOptions options;
+  options.max_rows_per_file = 30;
+  options.max_rows_per_group = 10;
+  ASSERT_EQ(inserter.CreateTableWithData("test_table", options), kLanceDBSuccess);
+  ASSERT_EQ(nearest_idx({ 42.f, 1.f, 0.f }), 42);
+  ASSERT_NE(inserter.CreateTableWithData("test_table"), kLanceDBSuccess);
+  lancedb_optimize_stats_t stats;
+  LanceDB::OptimizeOptions optimize_options;
+  optimize_options.prune = false;
+  optimize_options.optimize_indices = false;
+  optimize_options.target_rows_per_fragment = 1000;
+  ASSERT_EQ(db.Optimize("test_table", optimize_options, &stats), kLanceDBSuccess);
+  ASSERT_EQ(stats.fragments_removed, 4);
+
+  ASSERT_EQ(inserter.Insert("test_table", LanceDB::WriteOptions()), kLanceDBSuccess);
+
+  // overwrite replaces the rows
+  std::vector<int> new_idx = { 1000 };
+  std::vector<std::vector<float>> new_embeddings = { { 42.f, 1.f, 0.f } };
+  LanceDB::FieldData new_idx_data("idx", new_idx);
+  LanceDB::FieldData new_embedding_data("embedding", new_embeddings);
+  options = LanceDB::WriteOptions();
+  options.overwrite = true;
+  ASSERT_EQ(db.CreateBatchInserter(new_idx_data, new_embedding_data).Insert("test_table", options),
+            kLanceDBSuccess);
+  ASSERT_EQ(nearest_idx({ 0.f, 1.f, 0.f }), 1000);
+
+  // and overwrite mode replaces a whole table on create
+  ASSERT_EQ(inserter.CreateTableWithData("test_table", options), kLanceDBSuccess);
+  ASSERT_EQ(nearest_idx({ 0.f, 1.f, 0.f }), 0);
+}
+
+TEST(LanceDB, Float16) {
+  ASSERT_EQ(Float16(1.f).bits, 0x3c00);
+  ASSERT_EQ(Float16(-2.f).bits, 0xc000);
+  ASSERT_EQ(Float16(65504.f).bits, 0x7bff);
+  ASSERT_EQ(Float16(65520.f).bits, 0x7c00);
+  ASSERT_EQ(Float16(1e-8f).bits, 0);
+  ASSERT_EQ(Float16(5.9604645e-8f).bits, 1);  // smallest subnormal
+  ASSERT_EQ(Float16(1.f + 1.f / 2048).bits, 0x3c00);  // tie, to even
+  ASSERT_FLOAT_EQ((float)Float16(0.333f), 0.33300781f);
+
+  system("rm -rf test_float16.db");
+  LanceDB db("test_float16.db");
+  std::vector<int> idx = { 0, 1, 2 };
+  std::vector<std::vector<Float16>> embeddings = {
+      { 1.f, 0.f, 0.f, 0.f }, { 0.f, 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f, 0.f } };
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  ASSERT_EQ(embedding_data.GetDataType(), kLanceDBFieldTypeFloat16);
+  ASSERT_EQ(db.CreateBatchInserter(idx_data, embedding_data).CreateTableWithData("test_table"), kLanceDBSuccess);
+
+  // f32 rows are converted to the f16 column
+  std::vector<int> f32_idx = { 3 };
+  std::vector<std::vector<float>> f32_embeddings = { { 0.f, 0.f, 0.f, 0.25f } };
+  LanceDB::FieldData f32_idx_data("idx", f32_idx);
+  LanceDB::FieldData f32_embedding_data("embedding", f32_embeddings);
+  ASSERT_EQ(db.CreateBatchInserter(f32_idx_data, f32_embedding_data).Insert("test_table"), kLanceDBSuccess);
+
+  for (int expected: { 1, 3 }) {
+    std::vector<Float16> query(4, 0.f);
+    query[expected] = 1.f;
+    LanceDB::SearchResults sr;
+    ASSERT_EQ(db.Query("test_table", "embedding", query, sr), kLanceDBSuccess);
+    const lancedb_data_t& result = sr.Get();
+    ASSERT_EQ(((int32_t*)result.fields[0].data)[0], expected);
+    ASSERT_EQ(result.fields[1].data_type, kLanceDBFieldTypeFloat16);
+    ASSERT_EQ(result.fields[1].dimension, 4);
+    Float16 value = ((Float16*)result.fields[1].data)[expected];
+    ASSERT_FLOAT_EQ((float)value, expected == 3 ? 0.25f : 1.f);
+  }
+}
+
+TEST(LanceDB, SearchOptions) {
+  system("rm -rf test_search_options.db");
+  LanceDB db("test_search_options.db");
+  std::vector<int> idx;
+  std::vector<std::vector<float>> embeddings;
+  for (int i=0; i<200; i++) {
+    idx.push_back(i);
+    embeddings.push_back({ (float)i, 1.f, 0.f });
+  }
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+  ASSERT_EQ(inserter.CreateTableWithData("test_table"), kLanceDBSuccess);
+
+  std::vector<float> query = { 1.f, 0.f, 0.f };
+  LanceDB::SearchResults sr;
+  ASSERT_EQ(db.Query("test_table", "embedding", query, sr), kLanceDBSuccess);
+  ASSERT_EQ(sr.Get().fields[0].data_count, 10);
+
+  LanceDB::SearchOptions options;
+  options.limit = 100;
+  options.nprobes = 5;
+  options.refine_factor = 2;
+  LanceDB::SearchResults sr_100;
+  ASSERT_EQ(db.Query("test_table", "embedding", query, options, sr_100), kLanceDBSuccess);
+  ASSERT_EQ(sr_100.Get().fields[0].data_count, 100);
+
+  LanceDB::Table table;
+  ASSERT_EQ(db.OpenTable("test_table", table), kLanceDBSuccess);
+  options.limit = 5;
+  LanceDB::SearchResults sr_5;
+  ASSERT_EQ(db.Query(table, "embedding", query, options, sr_5), kLanceDBSuccess);
+  ASSERT_EQ(sr_5.Get().fields[0].data_count, 5);
+  // the nearest rows are the same whatever the limit
+  ASSERT_EQ(((int32_t*)sr_5.Get().fields[0].data)[0], ((int32_t*)sr_100.Get().fields[0].data)[0]);
+
+  // only the selected columns and the distance are returned
+  ASSERT_EQ(sr_5.Get().num_fields, 3);
+  options.select_columns = { "idx" };
+  LanceDB::SearchResults sr_idx;
+  ASSERT_EQ(db.Query(table, "embedding", query, options, sr_idx), kLanceDBSuccess);
+  ASSERT_EQ(sr_idx.Get().num_fields, 2);
+  ASSERT_EQ(std::string(sr_idx.Get().fields[0].name), "idx");
+  ASSERT_EQ(std::string(sr_idx.Get().fields[1].name), "_distance");
+  ASSERT_EQ(sr_idx.Get().fields[0].data_count, 5);
+  ASSERT_EQ(((int32_t*)sr_idx.Get().fields[0].data)[0], ((int32_t*)sr_5.Get().fields[0].data)[0]);
+
+  // selected columns without any row
+  options.filter = "idx < 0";
+  LanceDB::SearchResults sr_empty;
+  ASSERT_EQ(db.Query(table, "embedding", query, options, sr_empty), kLanceDBSuccess);
+  for (size_t i=0; i<sr_empty.Get().num_fields; i++) {
+    ASSERT_EQ(sr_empty.Get().fields[i].data_count, 0);
+  }
+}
+
+TEST(LanceDB, DistanceType) {
+  system("rm -rf test_distance_type.db");
+  LanceDB db("test_distance_type.db");
+  std::vector<int> idx = { 0, 1 };
+  std::vector<std::vector<float>> embeddings = { { 1.f, 0.f, 0.f }, { 10.f, 1.f, 0.f } };
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+  ASSERT_EQ(inserter.CreateTableWithData("test_table"), kLanceDBSuccess);
+
+  auto nearest_idx = [&](std::vector<float> query, lancedb_distance_type_t distance_type) {
+    LanceDB::SearchOptions options;
+    options.distance_type = distance_type;
+    LanceDB::SearchResults sr;
+    EXPECT_EQ(db.Query("test_table", "embedding", query, options, sr), kLanceDBSuccess);
+    return ((int32_t*)sr.Get().fields[0].data)[0];
+  };
+  // same direction as row 0, closer to row 1
+  ASSERT_EQ(nearest_idx({ 10.f, 0.f, 0.f }, kLanceDBDistanceCosine), 0);
+  ASSERT_EQ(nearest_idx({ 10.f, 0.f, 0.f }, kLanceDBDistanceL2), 1);
+  // row 1 has the larger dot product
+  ASSERT_EQ(nearest_idx({ 1.f, 0.f, 0.f }, kLanceDBDistanceDot), 1);
+
+  // indexed column, searched with the metric of the index
+  const int dim = 16;
+  std::vector<int> index_idx;
+  std::vector<std::vector<float>> index_embeddings;
+  srand(42);
+  for (int i=0; i<512; i++) {
+    index_idx.push_back(i);
+    std::vector<float> embedding(dim);
+    for (auto& v: embedding) {
+      v = (float)rand() / RAND_MAX;
+    }
+    index_embeddings.push_back(embedding);
+  }
+  LanceDB::FieldData index_idx_data("idx", index_idx);
+  LanceDB::FieldData index_embedding_data("embedding", index_embeddings);
+  auto index_inserter = db.CreateBatchInserter(index_idx_data, index_embedding_data);
+  ASSERT_EQ(index_inserter.CreateTableWithData("index_table"), kLanceDBSuccess);
+
+  LanceDB::IndexOptions index_options;
+  index_options.distance_type = kLanceDBDistanceL2;
+  index_options.num_partitions = 2;
+  index_options.num_sub_vectors = 4;
+  ASSERT_EQ(db.CreateIndex("index_table", "embedding", index_options), kLanceDBSuccess);
+  ASSERT_NE(db.CreateIndex("index_table", "no_such_column", index_options), kLanceDBSuccess);
+
+  LanceDB::SearchOptions options;
+  options.limit = 5;
+  options.nprobes = 2;
+  options.refine_factor = 20;
+  options.distance_type = kLanceDBDistanceL2;
+  LanceDB::SearchResults sr;
+  ASSERT_EQ(db.Query("index_table", "embedding", index_embeddings[7], options, sr), kLanceDBSuccess);
+  ASSERT_EQ(sr.Get().fields[0].data_count, 5);
+  ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[0], 7);
+}
+
+TEST(LanceDB, Filter) {
+  ASSERT_EQ(LanceDB::Filter::Eq("tenant", 42).ToString(), "`tenant` = 42");
+  ASSERT_EQ(LanceDB::Filter::Eq("name", "o'brien").ToString(), "`name` = 'o''brien'");
+  ASSERT_EQ((LanceDB::Filter::Ge("a`b", 1.5) && !LanceDB::Filter::IsNull("c")).ToString(),
+            "(`a``b` >= 1.5) AND (NOT (`c` IS NULL))");
+  ASSERT_EQ(LanceDB::Filter::In("tenant", std::vector<int>{ 1, 2 }).ToString(), "`tenant` IN (1, 2)");
+
+  system("rm -rf test_filter.db");
+  LanceDB db("test_filter.db");
+  std::vector<int> idx;
+  std::vector<int> tenant;
+  std::vector<std::vector<float>> embeddings;
+  for (int i=0; i<200; i++) {
+    idx.push_back(i);
+    tenant.push_back(i % 4);
+    embeddings.push_back({ (float)i, 1.f, 0.f });
+  }
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData tenant_data("tenant", tenant);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, tenant_data, embedding_data);
+  ASSERT_EQ(inserter.CreateTableWithData("test_table"), kLanceDBSuccess);
+
+  std::vector<float> query = { 1.f, 0.f, 0.f };
+  LanceDB::SearchOptions options;
+  options.limit = 10;
+  options.filter = (LanceDB::Filter::Eq("tenant", 2) && LanceDB::Filter::Lt("idx", 100)).ToString();
+  LanceDB::SearchResults sr;
+  ASSERT_EQ(db.Query("test_table", "embedding", query, options, sr), kLanceDBSuccess);
+  ASSERT_EQ(sr.Get().fields[0].data_count, 10);
+  for (size_t i=0; i<sr.Get().fields[0].data_count; i++) {
+    int row_idx = ((int32_t*)sr.Get().fields[0].data)[i];
+    ASSERT_EQ(((int32_t*)sr.Get().fields[1].data)[i], 2);
+    ASSERT_LT(row_idx, 100);
+  }
+
+  // the filter drops rows from the nearest ones
+  options.prefilter = false;
+  LanceDB::SearchResults sr_post;
+  ASSERT_EQ(db.Query("test_table", "embedding", query, options, sr_post), kLanceDBSuccess);
+  ASSERT_LE(sr_post.Get().fields[0].data_count, 10);
+  for (size_t i=0; i<sr_post.Get().fields[0].data_count; i++) {
+    ASSERT_EQ(((int32_t*)sr_post.Get().fields[1].data)[i], 2);
+  }
+
+  // no row matches, the empty results are released like any other
+  options.prefilter = true;
+  options.filter = LanceDB::Filter::Eq("tenant", -1).ToString();
+  LanceDB::SearchResults sr_empty;
+  ASSERT_EQ(db.Query("test_table", "embedding", query, options, sr_empty), kLanceDBSuccess);
+  for (size_t i=0; i<sr_empty.Get().num_fields; i++) {
+    ASSERT_EQ(sr_empty.Get().fields[i].data_count, 0);
+  }
+
+  options.filter = "no_such_column = 1";
+  LanceDB::SearchResults sr_invalid;
+  ASSERT_NE(db.Query("test_table", "embedding", query, options, sr_invalid), kLanceDBSuccess);
+}
+
+TEST(LanceDB, QueryBatch) {
+  system("rm -rf test_query_batch.db");
+  LanceDB db("test_query_batch.db");
+  std::vector<int> idx;
+  std::vector<std::vector<float>> embeddings;
+  for (int i=0; i<100; i++) {
+    idx.push_back(i);
+    embeddings.push_back({ std::cos(i * 0.06f), std::sin(i * 0.06f), 0.f });
+  }
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  auto inserter = db.CreateBatchInserter(idx_data, embedding_data);
+  ASSERT_EQ(inserter.CreateTableWithData("test_table"), kLanceDBSuccess);
+
+  std::vector<std::vector<float>> queries = { embeddings[3], embeddings[42], embeddings[97], embeddings[42] };
+  LanceDB::SearchOptions options;
+  options.limit = 3;
+  std::vector<LanceDB::SearchResults> results;
+  ASSERT_EQ(db.QueryBatch("test_table", "embedding", queries, options, results), kLanceDBSuccess);
+  ASSERT_EQ(results.size(), queries.size());
+  std::vector<int> expected = { 3, 42, 97, 42 };
+  for (size_t i=0; i<results.size(); i++) {
+    ASSERT_EQ(results[i].Get().fields[0].data_count, 3);
+    ASSERT_EQ(((int32_t*)results[i].Get().fields[0].data)[0], expected[i]);
+  }
+
+  // same results as one query at a time
+  LanceDB::SearchResults sr;
+  ASSERT_EQ(db.Query("test_table", "embedding", queries[1], options, sr), kLanceDBSuccess);
+  for (size_t i=0; i<3; i++) {
+    ASSERT_EQ(((int32_t*)sr.Get().fields[0].data)[i], ((int32_t*)results[1].Get().fields[0].data)[i]);
+  }
+
+  // the results are moved, never copied
+  static_assert(!std::is_copy_constructible<LanceDB::SearchResults>::value, "results own C memory");
+  LanceDB::SearchResults moved = std::move(results[0]);
+  ASSERT_TRUE(moved.IsValid());
+  ASSERT_FALSE(results[0].IsValid());
+  ASSERT_EQ(((int32_t*)moved.Get().fields[0].data)[0], 3);
+
+  queries.push_back({ 1.f, 0.f });
+  ASSERT_EQ(db.QueryBatch("test_table", "embedding", queries, options, results), kLanceDBInvalidData);
+  ASSERT_NE(db.QueryBatch("test_table", "no_such_column", std::vector<std::vector<float>>{ embeddings[0] }, results),
+            kLanceDBSuccess);
+}
+
+TEST(LanceDB, Appender) {
+  system("rm -rf test_appender.db");
+  LanceDB db("test_appender.db");
+  std::vector<int> idx = { 0 };
+  std::vector<std::vector<float>> embeddings = { { 1.f, 0.f, 0.f } };
+  LanceDB::FieldData idx_data("idx", idx);
+  LanceDB::FieldData embedding_data("embedding", embeddings);
+  ASSERT_EQ(db.CreateBatchInserter(idx_data, embedding_data).CreateTable("test_table"), kLanceDBSuccess);
+
+  auto nearest_idx = [&](const std::vector<float>& query) {
+    LanceDB::SearchResults sr;
+    EXPECT_EQ(db.Query("test_table", "embedding", query, sr), kLanceDBSuccess);
+    return ((int32_t*)sr.Get().fields[0].data)[0];
+  };
+
+  LanceDB::Appender appender;
+  ASSERT_EQ(appender.Append(idx_data, embedding_data), kLanceDBInvalidOperation);
+  LanceDB::Appender::Options options;
+  options.max_rows = 4;
+  ASSERT_EQ(db.OpenAppender("test_table", appender, options), kLanceDBSuccess);
+  ASSERT_TRUE(appender.IsOpened());
+
+  // buffered until 4 rows are appended
+  for (int i=0; i<4; i++) {
+    std::vector<int> row_idx = { 100 + i };
+    std::vector<std::vector<float>> row_embedding = { { 0.f, 1.f, (float)i } };
+    LanceDB::FieldData row_idx_data("idx", row_idx);
+    LanceDB::FieldData row_embedding_data("embedding", row_embedding);
+    ASSERT_EQ(appender.Append(row_idx_data, row_embedding_data), kLanceDBSuccess);
+    if (i < 3) {
+      ASSERT_EQ(nearest_idx({ 0.f, 1.f, 0.f }), 0);
+    }
+  }
+  ASSERT_EQ(nearest_idx({ 0.f, 1.f, 0.f }), 100);
+
+  std::vector<int> last_idx = { 200 };
+  std::vector<std::vector<float>> last_embedding = { { 0.f, 0.f, 1.f } };
+  LanceDB::FieldData last_idx_data("idx", last_idx);
+  LanceDB::FieldData last_embedding_data("embedding", last_embedding);
+  ASSERT_EQ(appender.Append(last_idx_data, last_embedding_data), kLanceDBSuccess);
+  ASSERT_EQ(appender.Close(), kLanceDBSuccess);
+  ASSERT_FALSE(appender.IsOpened());
+  ASSERT_EQ(nearest_idx({ 0.f, 0.f, 1.f }), 200);
+
+  // committed once the interval passes, without another append or a flush
+  LanceDB::Appender::Options interval_options;
+  interval_options.max_interval_ms = 50;
+  ASSERT_EQ(db.OpenAppender("test_table", appender, interval_options), kLanceDBSuccess);
+  std::vector<int> timed_idx = { 300 };
+  std::vector<std::vector<float>> timed_embedding = { { 1.f, 1.f, 1.f } };
+  LanceDB::FieldData timed_idx_data("idx", timed_idx);
+  LanceDB::FieldData timed_embedding_data("embedding", timed_embedding);
+  ASSERT_EQ(appender.Append(timed_idx_data, timed_embedding_data), kLanceDBSuccess);
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  ASSERT_EQ(nearest_idx({ 1.f, 1.f, 1.f }), 300);
+  ASSERT_EQ(appender.Close(), kLanceDBSuccess);
+}
+
 struct TestTable {
   int id;
   std::vector<float> embedding;
@@ -329,3 +955,36 @@ TEST(LanceDB, SchameAdapter) {
   }
   printf("...\n");
 }
+
+TEST(LanceDB, SchameAdapterChunked) {
+  system("rm -rf test_schema_adapter_chunked.db");
+
+  std::vector<TestTable> data = LoadTestData();
+  LanceDB db("test_schema_adapter_chunked.db");
+  TestTableSchema schema = TestTableSchema(db)
+    .SetCreateTable(true)
+    .SetCreateData(true)
+    .SetChunkSize(30);
+  ASSERT_EQ(schema.Run(data), kLanceDBSuccess);
+
+  // beans from the first, a middle and the last (partial) chunk
+  for (int i: { 0, 55, 99 }) {
+    TestTableResult res;
+    ASSERT_EQ(schema.Query("embedding", data[i].embedding, res), kLanceDBSuccess);
+    ASSERT_FALSE(res.results.empty());
+    ASSERT_EQ(res.results[0].id, i);
+    ASSERT_EQ(res.results[0].content, data[i].content);
+    ASSERT_EQ(res.results[0].chapter_title, data[i].chapter_title);
+  }
+
+  // a vector of another dimension fails the whole run, before any chunk is written
+  std::vector<TestTable> more = LoadTestData();
+  more[75].embedding.resize(10);
+  ASSERT_EQ(TestTableSchema(db).SetChunkSize(30).Run(more), kLanceDBInvalidData);
+  TestTableResult res;
+  ASSERT_EQ(schema.Query("embedding", data[0].embedding, res), kLanceDBSuccess);
+  ASSERT_GE(res.results.size(), 2u);
+  ASSERT_EQ(res.results[0].id, 0);
+  ASSERT_NE(res.results[1].id, 0);
+  ASSERT_EQ(TestTableSchema(db).Run(std::vector<TestTable>()), kLanceDBInvalidData);
+}